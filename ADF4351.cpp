@@ -8,235 +8,960 @@
 
 #include "ADF4351.h"
 
+// Largest MOD the 12-bit field can hold
+#define ADF4351_MAX_MOD 4095
+
+// Highest VCO frequency the 4/5 prescaler supports
+#define ADF4351_MAX_VCO_PRESCALER_45 3600000000ULL
+
+// Smallest INT allowed with the 4/5 and 8/9 prescalers
+#define ADF4351_MIN_INT_45 23
+#define ADF4351_MIN_INT_89 75
+
+// PFD limits in fractional-N and integer-N (FRAC = 0) operation
+#define ADF4351_MAX_PFD_FRAC 32000000
+#define ADF4351_MAX_PFD_INT 45000000
+
+// Highest reference frequency the doubler accepts
+#define ADF4351_MAX_REF_DOUBLER 30000000
+
+// Largest R counter value (10 bits)
+#define ADF4351_MAX_R 1023
+
+// Band select clock limits: low mode, and high mode (R3 DB23) which is
+// recommended above 125 kHz PFD and allows a divider of at most 254
+#define ADF4351_BAND_SELECT_LOW 125000
+#define ADF4351_BAND_SELECT_HIGH 500000
+
+// Band select clock cycles taken by one VCO calibration (approximate)
+#define ADF4351_VCO_CAL_CYCLES 10
+
+// Charge pump current codes (R2 DB12:9) with RSET = 5.1 kOhm: 2.50 mA,
+// and the 0.31 mA minimum that cycle slip reduction requires
+#define ADF4351_CP_CURRENT 7
+#define ADF4351_CP_CURRENT_CSR 0
+
+// Default clock divider (R3) when the fast lock timer is not in use
+#define ADF4351_CLOCK_DIVIDER 150
+
+// Largest 12-bit clock divider / fast lock timer value
+#define ADF4351_MAX_CLOCK_DIVIDER 4095
+
+// Largest error in mHz retune() accepts on the current MOD grid before it
+// falls back to a full setFrequency() (the result still rounds to the Hz)
+#define ADF4351_RETUNE_TOLERANCE 500
+
+// Greatest common divisor
+static uint64_t gcd(uint64_t a, uint64_t b) {
+  while (b != 0) {
+    uint64_t r = a % b;
+    a = b;
+    b = r;
+  }
+  return a;
+}
+
+// Output frequency error in mHz of PFD * (INT + FRAC / MOD) >> divider
+// Error = (PFD * (INT * MOD + FRAC) - VCO * MOD) / (MOD << divider), rounded
+static int32_t frequencyError(uint32_t frequency, uint32_t pfdFreq, const ADF4351Solution& solution) {
+  int64_t numerator = ((int64_t)solution.intValue * solution.mod + solution.frac) * pfdFreq -
+                      (((int64_t)frequency << solution.divider) * solution.mod);
+  int64_t denominator = (int64_t)solution.mod << solution.divider;
+  numerator *= 1000;
+  numerator += (numerator < 0) ? -denominator / 2 : denominator / 2;
+  return (int32_t)(numerator / denominator);
+}
+
+// True if a/b is at least as close to num/den as c/d
+static bool isCloser(uint32_t num, uint32_t den, uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
+  // |num/den - a/b| <= |num/den - c/d|  <=>  |num*b - a*den| * d <= |num*d - c*den| * b
+  int64_t errorAB = (int64_t)num * b - (int64_t)a * den;
+  int64_t errorCD = (int64_t)num * d - (int64_t)c * den;
+  if (errorAB < 0) errorAB = -errorAB;
+  if (errorCD < 0) errorCD = -errorCD;
+  return (uint64_t)errorAB * d <= (uint64_t)errorCD * b;
+}
+
+// Best approximation frac/mod of num/den (num < den) with mod <= maxMod
+// Walks the continued fraction expansion (O(log den) steps); if num/den
+// reduces to a modulus that fits, the last convergent is exact. Otherwise
+// the closer of the last fitting convergent and the largest fitting
+// semiconvergent is the best approximation with that bound
+static void bestFraction(uint32_t num, uint32_t den, uint32_t maxMod, uint32_t& frac, uint32_t& mod) {
+  // Convergents h[n-2]/k[n-2] and h[n-1]/k[n-1]
+  uint32_t h0 = 0, k0 = 1;
+  uint32_t h1 = 1, k1 = 0;
+  uint32_t p = num;
+  uint32_t q = den;
+  
+  while (q != 0) {
+    uint32_t a = p / q;
+    uint32_t k2 = a * k1 + k0;
+    
+    if (k2 > maxMod) {
+      // Largest semiconvergent whose denominator still fits
+      uint32_t t = (maxMod - k0) / k1;
+      uint32_t hs = t * h1 + h0;
+      uint32_t ks = t * k1 + k0;
+      if (t > 0 && isCloser(num, den, hs, ks, h1, k1)) {
+        h1 = hs;
+        k1 = ks;
+      }
+      break;
+    }
+    
+    uint32_t h2 = a * h1 + h0;
+    h0 = h1;
+    k0 = k1;
+    h1 = h2;
+    k1 = k2;
+    
+    uint32_t r = p - a * q;
+    p = q;
+    q = r;
+  }
+  
+  frac = h1;
+  mod = k1;
+}
+
 // Constructor
-ADF4351::ADF4351(uint8_t le_pin, uint8_t clk_pin, uint8_t data_pin, uint8_t ce_pin) {
-  _le_pin = le_pin;
-  _clk_pin = clk_pin;
-  _data_pin = data_pin;
+ADF4351Base::ADF4351Base(uint8_t ce_pin, uint8_t ld_pin) {
   _ce_pin = ce_pin;
+  _ld_pin = ld_pin;
   
   _frequency = 0;
+  _refFreq = 0;
   _powerLevel = 3;  // Default to +5dBm
   _outputEnabled = true;
   _lowNoiseMode = true;
+  _phase = 1;       // Recommended phase word
+  
+  _solution.intValue = 0;
+  _solution.frac = 0;
+  _solution.mod = 2;
+  _solution.divider = 0;
+  _solution.prescaler89 = true;
+  _solution.error = 0;
+  _solution.pfd.freq = 0;
+  _solution.pfd.rCounter = 1;
+  _solution.pfd.doubler = false;
+  _solution.pfd.rdiv2 = false;
+  _resolution = 0;
+  _pfdCount = 0;
+  _latchTime = 0;
+  _lockTime = 0;
+  _lockPending = false;
+  _latchBand = 0;
+  memset(_lockStats, 0, sizeof(_lockStats));
+  _lockDetectLock = NULL;
+  _planCacheCapacity = ADF4351_PLAN_CACHE_SIZE;
+  _planCacheHits = 0;
+  _planCacheMisses = 0;
+  clearPlanCache();
+  _fastLock = ADF4351_ASSIST_OFF;
+  _cycleSlip = ADF4351_ASSIST_OFF;
+  _fastLockTime = ADF4351_FASTLOCK_TIME;
+  _largeJump = true;
   
   // Initialize registers to 0
   for (int i = 0; i < 6; i++) {
     _registers[i] = 0;
+    _written[i] = 0;
   }
+  _dirty = 0;
+  _updateDepth = 0;
 }
 
-// Initialize the ADF4351
-void ADF4351::begin(uint32_t refFreq) {
-  // Store reference frequency
+// Set up the CE pin and the initial register values
+void ADF4351Base::beginRegisters(uint32_t refFreq) {
+  // Store reference frequency and list the PFDs it can produce
   _refFreq = refFreq;
+  buildPfdCandidates();
+  clearPlanCache();
   
-  // Set up pins
-  pinMode(_le_pin, OUTPUT);
-  pinMode(_clk_pin, OUTPUT);
-  pinMode(_data_pin, OUTPUT);
+  // Enable the chip
   pinMode(_ce_pin, OUTPUT);
+  digitalWrite(_ce_pin, HIGH);
   
-  // Set initial pin states
-  digitalWrite(_le_pin, HIGH);
-  digitalWrite(_clk_pin, LOW);
-  digitalWrite(_data_pin, LOW);
-  digitalWrite(_ce_pin, HIGH); // Enable the chip
+  // Lock detect: MUXOUT and LD are both set to digital lock detect, so
+  // either pin goes high once the PLL has locked
+  if (_lockDetectLock == NULL) {
+    _lockDetectLock = spin_lock_instance(spin_lock_claim_unused(true));
+  }
+  if (_ld_pin != ADF4351_NO_PIN) {
+    pinMode(_ld_pin, INPUT);
+    attachInterruptParam(digitalPinToInterrupt(_ld_pin), lockDetectIsr, RISING, this);
+  }
   
   // Initial register values
   
   // Register 0: RF Output Frequency Setting
-  _registers[0] = 0x00580000; // INT=88, FRAC=0
+  _registers[0] = 0x00580000; // INT=176, FRAC=0
   
   // Register 1: Phase value, Modulus value
-  _registers[1] = 0x08008011; // Phase=1, Prescaler=8/9, MOD=1
+  _registers[1] = 0x08008011; // Phase=1, Prescaler=8/9, MOD=2
   
   // Register 2: Low-noise and low-spur modes
-  _registers[2] = 0x00004E42; // Low-noise mode, MUXOUT=Digital Lock Detect, R=1
+  _registers[2] = 0x00004E42; // Low-noise mode, R=1, CP=2.5 mA, positive PD polarity
   
-  // Register 3: Output power, charge pump settings
-  _registers[3] = 0x000004B3; // Output power = +5dBm
+  // Register 3: Clock divider, fast lock and cycle slip settings
+  _registers[3] = 0x000004B3; // Clock divider=150, fast lock off
   
   // Register 4: VCO band selection, RF divider
-  _registers[4] = 0x00800024; // RF Divider=16, Band Select Clock Divider=40
+  _registers[4] = 0x00800024; // Fundamental feedback, RF Divider=1, output on at -4dBm
   
   // Register 5: LD pin mode
   _registers[5] = 0x00580005; // Lock Detect Pin Mode = Digital Lock Detect
   
-  // Write all registers (in reverse order 5 to 0)
-  for (int i = 5; i >= 0; i--) {
-    writeRegister(_registers[i]);
+  // Write all registers, the chip's contents are unknown after power-up
+  _dirty = 0x3F;
+}
+
+// Update registers for a new output frequency
+bool ADF4351Base::prepareFrequency(uint32_t frequency) {
+  // Check if frequency is within range (a uint32_t never exceeds 4.4 GHz)
+  if (frequency < 35000000) {
+    return false;
+  }
+  
+  // A band change or a long hop turns on the automatic lock assists
+  uint32_t previous = _frequency;
+  bool previousJump = _largeJump;
+  uint32_t hop = frequency > previous ? frequency - previous : previous - frequency;
+  _largeJump = previous == 0 || hop > ADF4351_LARGE_JUMP ||
+               calculateRFDivider(frequency) != calculateRFDivider(previous);
+  
+  // Keep the previous frequency if this one can't be synthesized
+  _frequency = frequency;
+  if (!updateRegisters()) {
+    _frequency = previous;
+    _largeJump = previousJump;
+    return false;
   }
   
-  // Set a default frequency (100 MHz)
-  setFrequency(100000000);
+  // R0 always goes out last: writing it loads the double-buffered
+  // settings and starts the VCO band selection
+  _dirty |= (1 << 0);
+  
+  return true;
 }
 
-// Set output frequency in Hz
-bool ADF4351::setFrequency(uint32_t frequency) {
-  // Check if frequency is within range
-  if (frequency < 35000000 || frequency > 4400000000UL) {
+// Update R0 alone for a frequency that the current PFD, RF divider,
+// prescaler and MOD can reach; returns false if a full update is needed
+bool ADF4351Base::prepareRetune(uint32_t frequency) {
+  if (frequency < 35000000 || _solution.pfd.freq == 0) {
     return false;
   }
   
-  _frequency = frequency;
-  updateRegisters();
+  // RF divider and prescaler follow from the frequency and live in R1/R4
+  uint8_t divider = calculateRFDivider(frequency);
+  uint64_t vcoFreq = (uint64_t)frequency << divider;
+  bool prescaler89 = vcoFreq > ADF4351_MAX_VCO_PRESCALER_45;
+  if (divider != _solution.divider || prescaler89 != _solution.prescaler89) {
+    return false;
+  }
+  
+  // AUTO lock assists belong to the hop that set them: a large hop needs
+  // them set in R2/R3 and the first step after one needs them cleared,
+  // both of which take a full update
+  uint32_t hop = frequency > _frequency ? frequency - _frequency : _frequency - frequency;
+  bool largeJump = hop > ADF4351_LARGE_JUMP;
+  bool autoAssist = _fastLock == ADF4351_ASSIST_AUTO ||
+                    (_cycleSlip == ADF4351_ASSIST_AUTO && isCycleSlipAvailable());
+  if (autoAssist && (largeJump || _largeJump)) {
+    return false;
+  }
+  
+  // Nearest point on the current MOD grid
+  uint32_t pfdFreq = _solution.pfd.freq;
+  uint32_t mod = _solution.mod;
+  uint32_t intValue = (uint32_t)(vcoFreq / pfdFreq);
+  uint32_t frac = (uint32_t)(((vcoFreq % pfdFreq) * mod + pfdFreq / 2) / pfdFreq);
+  if (frac >= mod) {
+    intValue++;
+    frac = 0;
+  }
+  
+  // The integer-N settings in R2/R3 depend on FRAC being 0
+  if ((frac == 0) != (_solution.frac == 0)) {
+    return false;
+  }
   
-  // Write all registers (in reverse order 5 to 0)
-  for (int i = 5; i >= 0; i--) {
-    writeRegister(_registers[i]);
+  uint32_t minInt = prescaler89 ? ADF4351_MIN_INT_89 : ADF4351_MIN_INT_45;
+  if (intValue < minInt || intValue > 65535) {
+    return false;
   }
   
+  ADF4351Solution solution = _solution;
+  solution.intValue = (uint16_t)intValue;
+  solution.frac = (uint16_t)frac;
+  solution.error = frequencyError(frequency, pfdFreq, solution);
+  if (solution.error > ADF4351_RETUNE_TOLERANCE || solution.error < -ADF4351_RETUNE_TOLERANCE) {
+    return false;
+  }
+  
+  _frequency = frequency;
+  _solution = solution;
+  _largeJump = largeJump;
+  
+  // Register 0: INT, FRAC
+  _registers[0] = ((uint32_t)intValue << 15) | (frac << 3) | 0;
+  _dirty |= (1 << 0);
+  
   return true;
 }
 
-// Set output power level (0-3)
-void ADF4351::setPowerLevel(uint8_t level) {
+// Update Register 4 with a new output power level (0-3)
+void ADF4351Base::preparePowerLevel(uint8_t level) {
   if (level > 3) level = 3;
   
   _powerLevel = level;
   
-  // Update Register 3 with new power level
-  // Clear the power level bits (bits 3-4)
-  _registers[3] &= ~(0x03 << 3);
+  // Clear the output power bits (bits 3-4)
+  _registers[4] &= ~(0x03 << 3);
   // Set the new power level
-  _registers[3] |= (_powerLevel << 3);
-  
-  // Write Register 3
-  writeRegister(_registers[3]);
+  _registers[4] |= (_powerLevel << 3);
 }
 
-// Enable/disable output
-void ADF4351::enableOutput(bool enable) {
+// Update Register 4 with output enable/disable
+void ADF4351Base::prepareOutput(bool enable) {
   _outputEnabled = enable;
   
-  // Update Register 4 with output enable/disable
   if (enable) {
-    // Clear the RF output enable bit (bit 5)
-    _registers[4] &= ~(1 << 5);
-  } else {
-    // Set the RF output enable bit (bit 5) to disable output
+    // Set the RF output enable bit (bit 5)
     _registers[4] |= (1 << 5);
+  } else {
+    // Clear the RF output enable bit (bit 5) to disable output
+    _registers[4] &= ~(1 << 5);
   }
-  
-  // Write Register 4
-  writeRegister(_registers[4]);
 }
 
-// Set phase value (0-4095)
-void ADF4351::setPhase(uint16_t phase) {
+// Update Register 1 with a new phase value (0-4095)
+void ADF4351Base::preparePhase(uint16_t phase) {
   if (phase > 4095) phase = 4095;
   
-  // Update Register 1 with new phase value
+  _phase = phase;
+  
   // Clear the phase value bits (bits 15-26)
   _registers[1] &= ~(0xFFF << 15);
   // Set the new phase value
   _registers[1] |= (phase << 15);
   
-  // Write Register 1
-  writeRegister(_registers[1]);
+  // The phase is double-buffered and only loads on the next R0 write
+  _dirty |= (1 << 0);
 }
 
-// Set low noise or low spur mode
-void ADF4351::setLowNoiseMode(bool lowNoise) {
+// Update Register 2 with low noise/spur mode
+void ADF4351Base::prepareLowNoiseMode(bool lowNoise) {
   _lowNoiseMode = lowNoise;
   
-  // Update Register 2 with low noise/spur mode
   if (lowNoise) {
-    // Set the low noise mode bit (bit 21)
-    _registers[2] |= (1 << 21);
-    // Clear the low spur mode bit (bit 20)
-    _registers[2] &= ~(1 << 20);
+    // Clear the noise mode bits (bits 29-30) for low noise mode
+    _registers[2] &= ~(0x03UL << 29);
   } else {
-    // Clear the low noise mode bit (bit 21)
-    _registers[2] &= ~(1 << 21);
-    // Set the low spur mode bit (bit 20)
-    _registers[2] |= (1 << 20);
+    // Set the noise mode bits (bits 29-30) for low spur mode
+    _registers[2] |= (0x03UL << 29);
+  }
+}
+
+// Update Register 3 with the fast lock policy
+void ADF4351Base::prepareFastLock(ADF4351Assist mode) {
+  _fastLock = mode;
+  _registers[3] = buildRegister3();
+}
+
+// Update Registers 2 and 3 with the cycle slip reduction policy
+void ADF4351Base::prepareCycleSlipReduction(ADF4351Assist mode) {
+  // The planner only looks for an RDIV2 path while CSR may be used, so
+  // cached plans and the current one may not fit the new policy
+  bool replan = (mode == ADF4351_ASSIST_OFF) != (_cycleSlip == ADF4351_ASSIST_OFF);
+  _cycleSlip = mode;
+  if (replan) {
+    clearPlanCache();
+    if (_frequency != 0) {
+      prepareFrequency(_frequency);
+    }
   }
   
-  // Write Register 2
-  writeRegister(_registers[2]);
+  // The charge pump current follows CSR
+  if (_solution.pfd.freq != 0) {
+    _registers[2] = buildRegister2();
+  }
+  _registers[3] = buildRegister3();
+}
+
+// Update Register 3 with the time spent in wide bandwidth mode
+void ADF4351Base::prepareFastLockTime(uint16_t time_us) {
+  _fastLockTime = time_us;
+  _registers[3] = buildRegister3();
 }
 
 // Get current frequency
-uint32_t ADF4351::getFrequency() {
+uint32_t ADF4351Base::getFrequency() {
   return _frequency;
 }
 
-// Get lock status (assuming MUXOUT is set to digital lock detect)
-bool ADF4351::isLocked() {
-  // This would require an additional pin to read the MUXOUT pin
-  // For now, we'll just return true
+// Get output power level
+uint8_t ADF4351Base::getPowerLevel() {
+  return _powerLevel;
+}
+
+// Get RF output state
+bool ADF4351Base::isOutputEnabled() {
+  return _outputEnabled;
+}
+
+// Get lock status from the LD/MUXOUT pin (true if no pin is connected)
+bool ADF4351Base::isLocked() {
+  if (_ld_pin == ADF4351_NO_PIN) {
+    return true;
+  }
+  return digitalRead(_ld_pin) == HIGH;
+}
+
+// Wait for the PLL to lock after the last R0 write
+int32_t ADF4351Base::waitForLock(uint32_t timeout_us) {
+  if (_ld_pin == ADF4351_NO_PIN) {
+    return -1;
+  }
+  
+  // The interrupt clears _lockPending on the first rising edge of LD
+  uint32_t start = micros();
+  while (_lockPending) {
+    if (micros() - start >= timeout_us) {
+      return -1;
+    }
+  }
+  uint32_t save = lockDetectEnter();
+  int32_t elapsed = (int32_t)(_lockTime - _latchTime);
+  lockDetectExit(save);
+  return elapsed;
+}
+
+// Record the time R0 was latched and arm the lock detect interrupt
+void ADF4351Base::markLatch() {
+  uint32_t save = lockDetectEnter();
+  // The previous frequency never locked
+  if (_lockPending) {
+    _lockStats[_latchBand].missed++;
+  }
+  // RF divider band now in the chip (R4 DB22:20)
+  _latchBand = (_written[4] >> 20) & 0x07;
+  if (_latchBand >= ADF4351_BANDS) _latchBand = ADF4351_BANDS - 1;
+  _latchTime = micros();
+  _lockPending = true;
+  lockDetectExit(save);
+}
+
+// Rising edge on the LD/MUXOUT pin
+void ADF4351Base::lockDetectIsr(void* param) {
+  ADF4351Base* adf = (ADF4351Base*)param;
+  uint32_t save = adf->lockDetectEnter();
+  if (!adf->_lockPending) {
+    adf->lockDetectExit(save);
+    return;
+  }
+  adf->_lockTime = micros();
+  adf->_lockPending = false;
+  
+  // Add the lock time to the statistics of the band
+  uint32_t elapsed = adf->_lockTime - adf->_latchTime;
+  ADF4351LockStats& stats = adf->_lockStats[adf->_latchBand];
+  if (stats.count == 0 || elapsed < stats.minTime) stats.minTime = elapsed;
+  if (elapsed > stats.maxTime) stats.maxTime = elapsed;
+  stats.count++;
+  stats.totalTime += elapsed;
+  
+  uint8_t bucket = 0;
+  uint32_t limit = ADF4351_LOCK_BUCKET_BASE;
+  while (bucket < ADF4351_LOCK_BUCKETS - 1 && elapsed >= limit) {
+    bucket++;
+    limit <<= 1;
+  }
+  stats.buckets[bucket]++;
+  adf->lockDetectExit(save);
+}
+
+// Get a snapshot of the lock time statistics of an RF divider band
+ADF4351LockStats ADF4351Base::getLockStats(uint8_t band) {
+  if (band >= ADF4351_BANDS) band = ADF4351_BANDS - 1;
+  
+  // Copy with the LD interrupt held off so the fields are consistent
+  uint32_t save = lockDetectEnter();
+  ADF4351LockStats stats = _lockStats[band];
+  lockDetectExit(save);
+  return stats;
+}
+
+// Clear the lock time statistics of all bands
+void ADF4351Base::clearLockStats() {
+  uint32_t save = lockDetectEnter();
+  memset(_lockStats, 0, sizeof(_lockStats));
+  lockDetectExit(save);
+}
+
+// Hold off the LD interrupt on both cores; returns the interrupt state
+// for lockDetectExit(). Before begin() there is no interrupt to hold off
+// beyond this core's
+uint32_t ADF4351Base::lockDetectEnter() {
+  if (_lockDetectLock == NULL) {
+    return save_and_disable_interrupts();
+  }
+  return spin_lock_blocking(_lockDetectLock);
+}
+
+// Release lockDetectEnter()
+void ADF4351Base::lockDetectExit(uint32_t save) {
+  if (_lockDetectLock == NULL) {
+    restore_interrupts(save);
+  } else {
+    spin_unlock(_lockDetectLock, save);
+  }
+}
+
+// Upper limit in us of histogram bucket n (0 = no limit)
+uint32_t ADF4351Base::lockBucketLimit(uint8_t n) {
+  if (n >= ADF4351_LOCK_BUCKETS - 1) {
+    return 0;
+  }
+  return (uint32_t)ADF4351_LOCK_BUCKET_BASE << n;
+}
+
+// Get the output frequency error of the current solution in millihertz
+int32_t ADF4351Base::getFrequencyError() {
+  return _solution.error;
+}
+
+// True if the current reference path gives the PFD the 50% duty cycle
+// cycle slip reduction needs
+bool ADF4351Base::isCycleSlipAvailable() {
+  return _solution.pfd.rdiv2 && !_solution.pfd.doubler;
+}
+
+// Set the channel resolution in Hz (0 = best effort)
+void ADF4351Base::setChannelResolution(uint32_t resolution) {
+  // Cached plans were made for the previous resolution
+  if (resolution != _resolution) {
+    clearPlanCache();
+  }
+  _resolution = resolution;
+}
+
+// Set how many plans the frequency cache keeps
+void ADF4351Base::setPlanCacheCapacity(uint8_t capacity) {
+  if (capacity > ADF4351_PLAN_CACHE_SIZE) capacity = ADF4351_PLAN_CACHE_SIZE;
+  _planCacheCapacity = capacity;
+  clearPlanCache();
+}
+
+// Drop all cached plans
+void ADF4351Base::clearPlanCache() {
+  for (uint8_t i = 0; i < ADF4351_PLAN_CACHE_SIZE; i++) {
+    _planCache[i].lastUse = 0;
+  }
+  _planCacheClock = 0;
+}
+
+// Number of plans served from the cache
+uint32_t ADF4351Base::getPlanCacheHits() {
+  return _planCacheHits;
+}
+
+// Number of plans the cache did not have
+uint32_t ADF4351Base::getPlanCacheMisses() {
+  return _planCacheMisses;
+}
+
+// True if the current solution runs the PLL in integer-N mode (FRAC = 0)
+bool ADF4351Base::isIntegerN() {
+  return _solution.pfd.freq != 0 && _solution.frac == 0;
+}
+
+// Get the PFD frequency of the current solution in Hz
+uint32_t ADF4351Base::getPfdFrequency() {
+  return _solution.pfd.freq;
+}
+
+// Get the predicted VCO calibration time of a retune in microseconds
+uint32_t ADF4351Base::getVcoCalibrationTime() {
+  uint32_t pfdFreq = _solution.pfd.freq;
+  if (pfdFreq == 0) {
+    return 0;
+  }
+  
+  // Band select clock = PFD / divider, rounded up to whole microseconds
+  uint64_t cycles = (uint64_t)ADF4351_VCO_CAL_CYCLES * bandSelectDivider(pfdFreq) * 1000000;
+  return (uint32_t)((cycles + pfdFreq - 1) / pfdFreq);
+}
+
+// Get the shadow value of register n (0-5)
+uint32_t ADF4351Base::getRegister(uint8_t n) {
+  return n < 6 ? _registers[n] : 0;
+}
+
+// Solve a frequency into INT/FRAC/MOD with integer arithmetic only
+bool ADF4351Base::solve(uint32_t frequency, uint32_t pfdFreq, ADF4351Solution& solution) {
+  if (pfdFreq == 0) {
+    return false;
+  }
+  
+  uint8_t divider = calculateRFDivider(frequency);
+  
+  // INT is the integer part of VCO / PFD. The VCO frequency needs 64 bits
+  // above 4.29 GHz, so split it as (frequency / PFD) << divider plus the
+  // shifted remainder, which stays within 32 bits for PFDs below 64 MHz
+  uint32_t intValue;
+  uint32_t remainder;
+  if (pfdFreq < (1UL << 26)) {
+    uint32_t shifted = (frequency % pfdFreq) << divider;
+    intValue = ((frequency / pfdFreq) << divider) + shifted / pfdFreq;
+    remainder = shifted % pfdFreq;
+  } else {
+    uint64_t vcoFreq = (uint64_t)frequency << divider;
+    intValue = (uint32_t)(vcoFreq / pfdFreq);
+    remainder = (uint32_t)(vcoFreq % pfdFreq);
+  }
+  
+  // FRAC/MOD is the closest fraction to remainder / PFD with MOD <= 4095
+  uint32_t frac = 0;
+  uint32_t mod = 1;
+  if (remainder != 0) {
+    bestFraction(remainder, pfdFreq, ADF4351_MAX_MOD, frac, mod);
+  }
+  
+  // Rounded up to the next integer
+  if (frac >= mod) {
+    intValue++;
+    frac = 0;
+    mod = 1;
+  }
+  
+  // MOD must be at least 2
+  if (mod < 2) {
+    mod = 2;
+    frac *= 2;
+  }
+  
+  // The 4/5 prescaler allows a lower INT but only up to a 3.6 GHz VCO
+  bool prescaler89 = ((uint64_t)frequency << divider) > ADF4351_MAX_VCO_PRESCALER_45;
+  uint32_t minInt = prescaler89 ? ADF4351_MIN_INT_89 : ADF4351_MIN_INT_45;
+  if (intValue < minInt || intValue > 65535) {
+    return false;
+  }
+  
+  solution.intValue = (uint16_t)intValue;
+  solution.frac = (uint16_t)frac;
+  solution.mod = (uint16_t)mod;
+  solution.divider = divider;
+  solution.prescaler89 = prescaler89;
+  solution.error = frequencyError(frequency, pfdFreq, solution);
+  
   return true;
 }
 
-// Private method to write a register value to the ADF4351
-void ADF4351::writeRegister(uint32_t value) {
-  // Pull LE low to begin the transfer
-  digitalWrite(_le_pin, LOW);
+// Pick the reference path and divider values for a frequency
+bool ADF4351Base::plan(uint32_t frequency, ADF4351Solution& solution) {
+  // Largest acceptable error in mHz (half the channel resolution)
+  uint64_t tolerance = (uint64_t)_resolution * 500;
+  bool found = false;
+  uint32_t bestError = 0;
+  ADF4351Solution candidate;
+  
+  // Cycle slip reduction needs the 50% duty cycle of an RDIV2 path, so
+  // while it may be used those are tried first, then the rest
+  uint8_t firstPass = _cycleSlip == ADF4351_ASSIST_OFF ? 1 : 0;
+  
+  for (uint8_t pass = firstPass; pass < 2; pass++) {
+    // Candidates are sorted by PFD, so the first one in tolerance wins
+    for (uint8_t i = 0; i < _pfdCount; i++) {
+      const ADF4351Pfd& pfd = _pfdCandidates[i];
+      if (pass == 0 && !(pfd.rdiv2 && !pfd.doubler)) {
+        continue;
+      }
+      if (!solve(frequency, pfd.freq, candidate)) {
+        continue;
+      }
+      
+      // Above 32 MHz the PFD is only usable in integer-N operation
+      if (pfd.freq > ADF4351_MAX_PFD_FRAC && candidate.frac != 0) {
+        continue;
+      }
+      candidate.pfd = pfd;
+      
+      uint32_t error = candidate.error < 0 ? -candidate.error : candidate.error;
+      if (_resolution == 0 || error <= tolerance) {
+        // Scale MOD so that stepping by the channel resolution only changes
+        // INT/FRAC; neighbouring channels can then be set with R0 alone
+        if (_resolution != 0 && candidate.frac != 0) {
+          uint64_t step = (uint64_t)_resolution << candidate.divider;
+          uint32_t channelMod = (uint32_t)(pfd.freq / gcd(pfd.freq, step));
+          uint32_t mod = candidate.mod / gcd(candidate.mod, channelMod) * channelMod;
+          if (mod <= ADF4351_MAX_MOD) {
+            candidate.frac = (uint16_t)(candidate.frac * (mod / candidate.mod));
+            candidate.mod = (uint16_t)mod;
+          }
+        }
+        solution = candidate;
+        return true;
+      }
+      
+      // Out of tolerance: remember the closest one in case none fits
+      if (!found || error < bestError) {
+        solution = candidate;
+        bestError = error;
+        found = true;
+      }
+    }
+  }
+  
+  return found;
+}
+
+// Private method to list the PFD settings reachable from the reference
+void ADF4351Base::buildPfdCandidates() {
+  _pfdCount = 0;
+  
+  for (uint16_t r = 1; r <= ADF4351_MAX_R; r++) {
+    // Stop once even the doubled reference can't beat the lowest entry kept
+    if (_pfdCount == ADF4351_PFD_CANDIDATES &&
+        ((uint64_t)_refFreq * 2) / r < _pfdCandidates[_pfdCount - 1].freq) {
+      break;
+    }
+    
+    for (uint8_t d = 0; d <= 1; d++) {
+      if (d && _refFreq > ADF4351_MAX_REF_DOUBLER) {
+        continue;
+      }
+      for (uint8_t t = 0; t <= 1; t++) {
+        // Only PFDs that are a whole number of Hz keep the solver exact
+        uint64_t numerator = (uint64_t)_refFreq << d;
+        uint32_t denominator = (uint32_t)r << t;
+        if (numerator % denominator != 0) {
+          continue;
+        }
+        uint64_t freq = numerator / denominator;
+        if (freq > ADF4351_MAX_PFD_INT || freq == 0) {
+          continue;
+        }
+        
+        // Insert in descending order, keeping the first setting per PFD
+        uint8_t pos = 0;
+        while (pos < _pfdCount && _pfdCandidates[pos].freq > freq) {
+          pos++;
+        }
+        if (pos == ADF4351_PFD_CANDIDATES || (pos < _pfdCount && _pfdCandidates[pos].freq == freq)) {
+          continue;
+        }
+        if (_pfdCount < ADF4351_PFD_CANDIDATES) {
+          _pfdCount++;
+        }
+        for (uint8_t i = _pfdCount - 1; i > pos; i--) {
+          _pfdCandidates[i] = _pfdCandidates[i - 1];
+        }
+        _pfdCandidates[pos].freq = (uint32_t)freq;
+        _pfdCandidates[pos].rCounter = r;
+        _pfdCandidates[pos].doubler = d;
+        _pfdCandidates[pos].rdiv2 = t;
+      }
+    }
+  }
+}
+
+// Solve a range of frequencies into a sweep plan
+bool ADF4351Base::compileSweep(ADF4351SweepPlan& plan, uint32_t start, uint32_t stop, uint32_t step, uint32_t resolution) {
+  plan.clear();
+  if (step == 0 || stop < start) {
+    return false;
+  }
+  
+  // Save the driver's own state; compiling goes through prepareFrequency()
+  uint32_t frequency = _frequency;
+  ADF4351Solution solution = _solution;
+  uint32_t registers[6];
+  memcpy(registers, _registers, sizeof(registers));
+  bool largeJump = _largeJump;
+  uint8_t dirty = _dirty;
+  uint32_t channelResolution = _resolution;
+  
+  // Sweep frequencies would only push useful plans out of the cache, so
+  // the cache is off and the plan's resolution can't leak into it
+  uint8_t cacheCapacity = _planCacheCapacity;
+  _planCacheCapacity = 0;
+  _resolution = resolution;
   
-  // Send 32 bits, MSB first
-  for (int i = 31; i >= 0; i--) {
-    // Set DATA pin based on bit value
-    digitalWrite(_data_pin, (value >> i) & 0x01);
+  // Register contents after the previous step; the first step sends all
+  uint32_t previous[6];
+  uint32_t words[6];
+  bool ok = true;
+  for (uint32_t f = start; f <= stop && f >= start; f += step) {
+    if (!prepareFrequency(f)) {
+      ok = false;
+      break;
+    }
     
-    // Pulse the clock
-    digitalWrite(_clk_pin, HIGH);
-    delayMicroseconds(1);
-    digitalWrite(_clk_pin, LOW);
-    delayMicroseconds(1);
+    uint8_t count = 0;
+    for (int i = 5; i >= 0; i--) {
+      if (plan.getStepCount() == 0 || i == 0 || _registers[i] != previous[i]) {
+        words[count++] = _registers[i];
+      }
+    }
+    if (!plan.appendStep(words, count)) {
+      ok = false;
+      break;
+    }
+    memcpy(previous, _registers, sizeof(previous));
   }
   
-  // Pull LE high to latch the data
-  digitalWrite(_le_pin, HIGH);
-  delayMicroseconds(1);
+  _planCacheCapacity = cacheCapacity;
+  _resolution = channelResolution;
+  _frequency = frequency;
+  _solution = solution;
+  memcpy(_registers, registers, sizeof(registers));
+  _largeJump = largeJump;
+  _dirty = dirty;
+  
+  return ok;
+}
+
+// Private method to plan a frequency through the cache
+bool ADF4351Base::cachedPlan(uint32_t frequency, ADF4351Solution& solution) {
+  if (_planCacheCapacity == 0) {
+    return plan(frequency, solution);
+  }
+  
+  // Look the frequency up, noting the least recently used slot on the way
+  uint8_t victim = 0;
+  for (uint8_t i = 0; i < _planCacheCapacity; i++) {
+    ADF4351PlanCacheEntry& entry = _planCache[i];
+    if (entry.lastUse != 0 && entry.frequency == frequency) {
+      entry.lastUse = ++_planCacheClock;
+      solution = entry.solution;
+      _planCacheHits++;
+      return true;
+    }
+    if (entry.lastUse < _planCache[victim].lastUse) {
+      victim = i;
+    }
+  }
+  
+  _planCacheMisses++;
+  if (!plan(frequency, solution)) {
+    return false;
+  }
+  
+  ADF4351PlanCacheEntry& entry = _planCache[victim];
+  entry.frequency = frequency;
+  entry.lastUse = ++_planCacheClock;
+  entry.solution = solution;
+  return true;
 }
 
 // Private method to update register values based on current settings
-void ADF4351::updateRegisters() {
-  // Calculate RF divider
-  uint8_t divider = calculateRFDivider(_frequency);
-  uint8_t rfDivider = 1 << divider;
-  
-  // Calculate VCO frequency
-  uint32_t vcoFreq = _frequency * rfDivider;
-  
-  // Calculate PFD frequency (Phase Frequency Detector)
-  // For simplicity, we'll use R=1 (Reference Divider)
-  uint32_t refDivider = 1;
-  uint32_t pfdFreq = _refFreq / refDivider;
-  
-  // Calculate INT and FRAC values
-  // INT is the integer division of VCO frequency by PFD frequency
-  // FRAC is the fractional part, represented as FRAC/MOD
-  uint16_t mod = 1000; // Modulus value
-  uint16_t intValue = vcoFreq / pfdFreq;
-  uint32_t fracValue = (uint32_t)((((double)vcoFreq / (double)pfdFreq) - intValue) * mod);
+bool ADF4351Base::updateRegisters() {
+  // Calculate the reference path, INT, FRAC, MOD and the RF divider
+  if (!cachedPlan(_frequency, _solution)) {
+    return false;
+  }
+  const ADF4351Pfd& pfd = _solution.pfd;
+  uint8_t divider = _solution.divider;
+  uint16_t intValue = _solution.intValue;
+  uint16_t fracValue = _solution.frac;
+  uint16_t mod = _solution.mod;
   
   // Update registers with calculated values
   
   // Register 0: INT, FRAC
-  _registers[0] = (intValue << 15) | (fracValue << 3) | 0;
+  _registers[0] = ((uint32_t)intValue << 15) | ((uint32_t)fracValue << 3) | 0;
   
   // Register 1: Phase, Prescaler, MOD
-  _registers[1] = (0 << 15) | (1 << 27) | (mod << 3) | 1;
+  _registers[1] = ((uint32_t)_phase << 15) | ((uint32_t)_solution.prescaler89 << 27) | ((uint32_t)mod << 3) | 1;
   
-  // Register 2: Low-noise mode, MUXOUT, R-counter
-  _registers[2] = (_lowNoiseMode ? (1 << 21) : (1 << 20)) | (6 << 9) | (refDivider << 14) | 2;
+  // Register 2: Noise mode, MUXOUT, doubler, RDIV2, R-counter, charge pump, LDF, LDP, PD polarity
+  _registers[2] = buildRegister2();
   
-  // Register 3: Output power, charge pump settings
-  _registers[3] = (_powerLevel << 3) | (3 << 10) | 3;
+  // Band select clock as fast as allowed, so VCO calibration is short
+  uint8_t bandSelectClockDiv = bandSelectDivider(pfd.freq);
   
-  // Register 4: RF divider, band select clock divider, VCO settings
-  uint8_t bandSelectClockDiv = 200; // Suitable for most applications
-  _registers[4] = (divider << 20) | (_outputEnabled ? 0 : (1 << 5)) | (bandSelectClockDiv << 12) | 4;
+  // Register 3: Band select clock mode, ABP, CSR, fast lock timer
+  _registers[3] = buildRegister3();
   
-  // Register 5: LD pin mode
-  _registers[5] = (1 << 22) | 5; // Digital lock detect
+  // Register 4: Feedback, RF divider, band select clock divider, output
+  _registers[4] = (1UL << 23) | ((uint32_t)divider << 20) | ((uint32_t)bandSelectClockDiv << 12) |
+                  (_outputEnabled ? (1 << 5) : 0) | (_powerLevel << 3) | 4;
+  
+  // Register 5: LD pin mode (bits 19-20 are reserved and must be set)
+  _registers[5] = (1UL << 22) | (0x03UL << 19) | 5; // Digital lock detect
+  
+  return true;
+}
+
+// True if a lock assist policy is in effect for the current frequency
+bool ADF4351Base::assistActive(ADF4351Assist mode) {
+  return mode == ADF4351_ASSIST_ON || (mode == ADF4351_ASSIST_AUTO && _largeJump);
+}
+
+// True if cycle slip reduction is set for the current frequency: the
+// policy asks for it and the PFD has the 50% duty cycle it needs
+bool ADF4351Base::cycleSlipActive() {
+  return assistActive(_cycleSlip) && isCycleSlipAvailable();
+}
+
+// Private method to build Register 2 for the current solution
+uint32_t ADF4351Base::buildRegister2() {
+  const ADF4351Pfd& pfd = _solution.pfd;
+  
+  // FRAC = 0: integer-N lock detect (LDF = 5 cycles, LDP = 6 ns);
+  // fractional-N uses LDF = 40 cycles, LDP = 10 ns
+  bool integerN = _solution.frac == 0;
+  
+  // 2.5 mA charge pump, or the 0.31 mA minimum that CSR requires
+  uint32_t chargePump = cycleSlipActive() ? ADF4351_CP_CURRENT_CSR : ADF4351_CP_CURRENT;
+  
+  // Noise mode, MUXOUT, doubler, RDIV2, R-counter, charge pump, LDF, LDP, PD polarity
+  return (_lowNoiseMode ? 0 : (0x03UL << 29)) | (6UL << 26) |
+         ((uint32_t)pfd.doubler << 25) | ((uint32_t)pfd.rdiv2 << 24) | ((uint32_t)pfd.rCounter << 14) |
+         (chargePump << 9) | (integerN ? ((1 << 8) | (1 << 7)) : 0) | (1 << 6) | 2;
+}
+
+// Private method to build Register 3 from the current solution and policies
+uint32_t ADF4351Base::buildRegister3() {
+  uint32_t pfdFreq = _solution.pfd.freq;
+  bool bandSelectHigh = pfdFreq > ADF4351_BAND_SELECT_LOW;
+  // FRAC = 0 takes the 3 ns antibacklash pulse, fractional-N 6 ns
+  bool integerN = _solution.frac == 0;
+  bool cycleSlip = cycleSlipActive();
+  bool fastLock = assistActive(_fastLock);
+  
+  // Fast lock keeps the wide loop bandwidth for timer * MOD / PFD after
+  // each R0 write: timer = time * PFD / MOD, rounded, 1 to 4095
+  uint32_t clockDiv = ADF4351_CLOCK_DIVIDER;
+  if (fastLock) {
+    uint64_t scaled = (uint64_t)_fastLockTime * pfdFreq;
+    uint64_t denominator = (uint64_t)_solution.mod * 1000000;
+    uint64_t timer = (scaled + denominator / 2) / denominator;
+    if (timer < 1) timer = 1;
+    if (timer > ADF4351_MAX_CLOCK_DIVIDER) timer = ADF4351_MAX_CLOCK_DIVIDER;
+    clockDiv = (uint32_t)timer;
+  }
+  
+  // Band select clock mode, ABP, CSR, CLK DIV MODE (01 = fast lock), clock divider
+  return (bandSelectHigh ? (1UL << 23) : 0) | (integerN ? (1UL << 22) : 0) |
+         (cycleSlip ? (1UL << 18) : 0) | (fastLock ? (1UL << 15) : 0) | (clockDiv << 3) | 3;
+}
+
+// Smallest band select clock divider that keeps the clock within its limit
+uint8_t ADF4351Base::bandSelectDivider(uint32_t pfdFreq) {
+  uint32_t limit = pfdFreq > ADF4351_BAND_SELECT_LOW ? ADF4351_BAND_SELECT_HIGH : ADF4351_BAND_SELECT_LOW;
+  uint32_t divider = (pfdFreq + limit - 1) / limit;
+  
+  if (divider < 1) divider = 1;
+  if (divider > 254) divider = 254;
+  return (uint8_t)divider;
 }
 
 // Calculate RF divider value based on frequency
-uint8_t ADF4351::calculateRFDivider(uint32_t frequency) {
+uint8_t ADF4351Base::calculateRFDivider(uint32_t frequency) {
   if (frequency < 68750000) {
     return 6; // Divide by 64
   } else if (frequency < 137500000) {
@@ -253,3 +978,53 @@ uint8_t ADF4351::calculateRFDivider(uint32_t frequency) {
     return 0; // Divide by 1
   }
 }
+
+// Sweep plan on a caller-supplied word buffer
+ADF4351SweepPlan::ADF4351SweepPlan(uint32_t* buffer, uint32_t capacity) {
+  _buffer = buffer;
+  _capacity = capacity;
+  _count = 0;
+  _steps = 0;
+}
+
+// Drop all steps
+void ADF4351SweepPlan::clear() {
+  _count = 0;
+  _steps = 0;
+}
+
+// Append one step's words if they fit
+bool ADF4351SweepPlan::appendStep(const uint32_t* words, uint8_t count) {
+  if (count > _capacity - _count) {
+    return false;
+  }
+  
+  for (uint8_t i = 0; i < count; i++) {
+    _buffer[_count++] = words[i];
+  }
+  _steps++;
+  return true;
+}
+
+// Number of words in the plan
+uint32_t ADF4351SweepPlan::getWordCount() const {
+  return _count;
+}
+
+// Number of steps in the plan
+uint32_t ADF4351SweepPlan::getStepCount() const {
+  return _steps;
+}
+
+// Memory used by the words in bytes
+uint32_t ADF4351SweepPlan::getBytes() const {
+  return _count * sizeof(uint32_t);
+}
+
+// Memory per step in 1/100 byte
+uint32_t ADF4351SweepPlan::getBytesPerStep100() const {
+  if (_steps == 0) {
+    return 0;
+  }
+  return (uint32_t)((uint64_t)_count * sizeof(uint32_t) * 100 / _steps);
+}
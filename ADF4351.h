@@ -1,9 +1,18 @@
 /*
  * ADF4351.h - Library for controlling the ADF4351 wideband frequency synthesizer
- * 
+ *
  * This library provides a simple interface for controlling the ADF4351 chip
  * with the Raspberry Pi Pico 2 or other Arduino-compatible microcontrollers.
- * 
+ *
+ * The driver is a class template over a register transport policy (see
+ * ADF4351_Bus.h). ADF4351 is the digitalWrite bit-bang version with pins
+ * chosen at run time; the other policies fix the pins at compile time:
+ *
+ *   ADF4351 adf4351(LE, CLK, DATA, CE);                    // GPIO bit-bang
+ *   ADF4351T<ADF4351SioBus<5, 2, 3>> adf4351(CE);           // fast SIO bit-bang
+ *   ADF4351T<ADF4351SpiBus<5, 2, 3>> adf4351(CE);           // hardware SPI
+ *   ADF4351T<ADF4351PioBus<5, 2, 3>> adf4351(CE);           // PIO state machine
+ *
  * Created: March 2025
  */
 
@@ -11,59 +20,552 @@
 #define ADF4351_H
 
 #include <Arduino.h>
+#include <hardware/sync.h>
+#include "ADF4351_Bus.h"
 
-class ADF4351 {
+// Pin number meaning "not connected"
+#define ADF4351_NO_PIN 0xFF
+
+// Number of PFD settings the planner keeps per reference frequency
+#ifndef ADF4351_PFD_CANDIDATES
+#define ADF4351_PFD_CANDIDATES 16
+#endif
+
+// Number of RF divider bands (divide by 1 to 64)
+#define ADF4351_BANDS 7
+
+// Lock time histogram: bucket 0 counts locks under ADF4351_LOCK_BUCKET_BASE
+// microseconds, each following bucket doubles the limit and the last one
+// collects everything above
+#ifndef ADF4351_LOCK_BUCKETS
+#define ADF4351_LOCK_BUCKETS 12
+#endif
+#ifndef ADF4351_LOCK_BUCKET_BASE
+#define ADF4351_LOCK_BUCKET_BASE 16
+#endif
+
+// Largest number of plans the frequency cache can hold
+#ifndef ADF4351_PLAN_CACHE_SIZE
+#define ADF4351_PLAN_CACHE_SIZE 8
+#endif
+
+// Default time the fast lock mode keeps the wide loop bandwidth (us)
+#ifndef ADF4351_FASTLOCK_TIME
+#define ADF4351_FASTLOCK_TIME 40
+#endif
+
+// Frequency hop (Hz) above which the automatic lock assists turn on; an
+// RF divider band change always counts as a large jump
+#ifndef ADF4351_LARGE_JUMP
+#define ADF4351_LARGE_JUMP 10000000
+#endif
+
+// Policy for the fast lock and cycle slip reduction features
+enum ADF4351Assist {
+  ADF4351_ASSIST_OFF,  // Never used
+  ADF4351_ASSIST_ON,   // Used for every frequency change
+  ADF4351_ASSIST_AUTO  // Used for band changes and large jumps only
+};
+
+// Reference path setting: PFD = REF * (1 + D) / (R * (1 + T))
+struct ADF4351Pfd {
+  uint32_t freq;     // Resulting PFD frequency in Hz
+  uint16_t rCounter; // R (1-1023)
+  bool doubler;      // D, reference doubler
+  bool rdiv2;        // T, reference divide-by-2
+};
+
+// PLL divider values for one output frequency
+// Output = PFD * (INT + FRAC / MOD) / (1 << divider)
+struct ADF4351Solution {
+  uint16_t intValue; // INT (23-65535, or 75-65535 with the 8/9 prescaler)
+  uint16_t frac;     // FRAC (0 to MOD - 1)
+  uint16_t mod;      // MOD (2-4095)
+  uint8_t divider;   // RF divider select (0-6, divide by 1 to 64)
+  bool prescaler89;  // 8/9 prescaler (VCO above 3.6 GHz), otherwise 4/5
+  int32_t error;     // Output frequency error in mHz (actual - requested)
+  ADF4351Pfd pfd;    // Reference path (filled in by plan())
+};
+
+// One entry of the plan cache
+struct ADF4351PlanCacheEntry {
+  uint32_t frequency;        // Requested frequency in Hz
+  uint32_t lastUse;          // Use counter value at the last hit, 0 = empty
+  ADF4351Solution solution;  // Planned reference path and divider values
+};
+
+// Measured lock times for one RF divider band (needs the LD pin)
+struct ADF4351LockStats {
+  uint32_t count;     // Locks measured
+  uint32_t missed;    // R0 latches followed by another before lock
+  uint32_t minTime;   // Shortest lock time in us
+  uint32_t maxTime;   // Longest lock time in us
+  uint64_t totalTime; // Sum of lock times in us (mean = totalTime / count)
+  uint32_t buckets[ADF4351_LOCK_BUCKETS]; // Histogram, see lockBucketLimit()
+};
+
+// Precompiled sweep: the register words of every step, packed back to back
+// in a caller-supplied buffer. The first step holds all six registers, each
+// following step only the ones that change; every step ends with its R0
+// word (address bits 000), which is what latches the new frequency
+class ADF4351SweepPlan {
   public:
+    // Use buffer (capacity words) for the plan
+    ADF4351SweepPlan(uint32_t* buffer, uint32_t capacity);
+
+    // Drop all steps
+    void clear();
+
+    // Append one step's words; false (and nothing added) if they don't fit
+    bool appendStep(const uint32_t* words, uint8_t count);
+
+    // Get word i of the plan
+    inline uint32_t word(uint32_t i) const { return _buffer[i]; }
+
+    // Number of words / steps in the plan
+    uint32_t getWordCount() const;
+    uint32_t getStepCount() const;
+
+    // Memory used by the words, in total and per step in 1/100 byte
+    // (e.g. 412 = 4.12 bytes per step)
+    uint32_t getBytes() const;
+    uint32_t getBytesPerStep100() const;
+
+  private:
+    uint32_t* _buffer;   // Caller's word buffer
+    uint32_t _capacity;  // Buffer size in words
+    uint32_t _count;     // Words in use
+    uint32_t _steps;     // Steps in the plan
+};
+
+// Transport-independent state and register calculation
+class ADF4351Base {
+  public:
+    // Solve a frequency into INT/FRAC/MOD with integer arithmetic only
+    // FRAC/MOD is exact when it reduces to MOD <= 4095, otherwise the best
+    // rational approximation with that bound
+    // Returns false if INT falls outside the range the prescaler allows
+    static bool solve(uint32_t frequency, uint32_t pfdFreq, ADF4351Solution& solution);
+
+    // Pick the reference path and divider values for a frequency: the
+    // highest PFD (up to 32 MHz, or 45 MHz when FRAC comes out 0) that meets
+    // the channel resolution, falling back to the smallest error. While
+    // cycle slip reduction may be used, paths through RDIV2 without the
+    // doubler come first
+    bool plan(uint32_t frequency, ADF4351Solution& solution);
+
+    // Set the channel resolution in Hz: the planner only accepts a PFD whose
+    // solution lands within half of it, and picks MOD so that steps of the
+    // resolution can be taken by retune(). 0 (default) accepts the best
+    // approximation at the highest PFD
+    void setChannelResolution(uint32_t resolution);
+
+    // True if the current frequency is set in integer-N mode (FRAC = 0):
+    // no fractional spurs, PFD up to 45 MHz and faster lock detect
+    bool isIntegerN();
+
+    // Solve start, start + step, ... up to stop into plan, using the
+    // current power, phase, noise and lock assist settings and, for this
+    // plan only, the channel resolution given (usually step). The driver's
+    // own frequency, registers and resolution are left as they were
+    // Returns false if a frequency can't be synthesized or the buffer is
+    // full; the plan then holds the steps before it
+    bool compileSweep(ADF4351SweepPlan& plan, uint32_t start, uint32_t stop, uint32_t step, uint32_t resolution);
+
+    // Set how many plans the frequency cache keeps (0 disables it, at most
+    // ADF4351_PLAN_CACHE_SIZE). Revisited frequencies then skip the planner;
+    // the least recently used plan is replaced when the cache is full
+    void setPlanCacheCapacity(uint8_t capacity);
+
+    // Drop all cached plans (the counters are kept)
+    void clearPlanCache();
+
+    // Number of setFrequency() plans served from / missing in the cache
+    uint32_t getPlanCacheHits();
+    uint32_t getPlanCacheMisses();
+
+    // Get the PFD frequency of the current solution in Hz
+    uint32_t getPfdFrequency();
+
+    // Get the predicted VCO calibration (band select) time in microseconds
+    // that each retune spends before the PLL starts to lock
+    uint32_t getVcoCalibrationTime();
+
+    // Get current frequency
+    uint32_t getFrequency();
+
+    // Get the output power level (0-3) and RF output state
+    uint8_t getPowerLevel();
+    bool isOutputEnabled();
+
+    // Get lock status from the LD/MUXOUT pin (always true without one)
+    bool isLocked();
+
+    // Wait up to timeout_us for the PLL to lock after the last R0 write
+    // Returns the time from the R0 latch to the rising edge of LD in
+    // microseconds, or -1 on timeout or without an LD pin. A timeout of 0
+    // only checks whether lock has already been reached
+    int32_t waitForLock(uint32_t timeout_us);
+
+    // Get a snapshot of the lock time statistics of an RF divider band
+    // (0-6, output frequency range 2200 MHz / (1 << band) and up)
+    ADF4351LockStats getLockStats(uint8_t band);
+
+    // Clear the lock time statistics of all bands
+    void clearLockStats();
+
+    // Upper limit in us (exclusive) of histogram bucket n; 0 for the last
+    // bucket, which has no upper limit
+    static uint32_t lockBucketLimit(uint8_t n);
+
+    // Get the output frequency error of the last setFrequency() in
+    // millihertz (actual output - requested frequency)
+    int32_t getFrequencyError();
+
+    // True if the current reference path lets cycle slip reduction run
+    // (RDIV2 on, doubler off); otherwise CSR stays off whatever the policy
+    bool isCycleSlipAvailable();
+
+    // Get the shadow value of register n (0-5)
+    uint32_t getRegister(uint8_t n);
+
+  protected:
     // Constructor
-    ADF4351(uint8_t le_pin, uint8_t clk_pin, uint8_t data_pin, uint8_t ce_pin);
-    
+    ADF4351Base(uint8_t ce_pin, uint8_t ld_pin);
+
+    // Set up the CE and LD pins and the initial register values
+    void beginRegisters(uint32_t refFreq);
+
+    // Update the shadow registers; only registers that end up differing
+    // from what was last written go out on the next writeRegisters()
+    bool prepareFrequency(uint32_t frequency);
+    bool prepareRetune(uint32_t frequency);
+    void preparePowerLevel(uint8_t level);
+    void prepareOutput(bool enable);
+    void preparePhase(uint16_t phase);
+    void prepareLowNoiseMode(bool lowNoise);
+    void prepareFastLock(ADF4351Assist mode);
+    void prepareCycleSlipReduction(ADF4351Assist mode);
+    void prepareFastLockTime(uint16_t time_us);
+
+    // Timestamp an R0 latch for waitForLock()
+    void markLatch();
+
+    // Pin definitions
+    uint8_t _ce_pin;   // Chip Enable Pin
+    uint8_t _ld_pin;   // Lock Detect (LD or MUXOUT) Pin, or ADF4351_NO_PIN
+
+    // Current settings
+    uint32_t _frequency;    // Current frequency in Hz
+    uint32_t _refFreq;      // Reference frequency in Hz
+    uint8_t _powerLevel;    // Output power level (0-3)
+    bool _outputEnabled;    // Output state
+    bool _lowNoiseMode;     // Low noise mode state
+    uint16_t _phase;        // Phase value (0-4095)
+    ADF4351Solution _solution; // Divider values for _frequency
+    uint32_t _resolution;   // Channel resolution in Hz (0 = best effort)
+
+    // PFD settings reachable from _refFreq, highest frequency first
+    ADF4351Pfd _pfdCandidates[ADF4351_PFD_CANDIDATES];
+    uint8_t _pfdCount;
+
+    // Register values
+    uint32_t _registers[6]; // 6 registers, 32 bits each
+    uint32_t _written[6];   // Values last written to the chip
+    uint8_t _dirty;         // Bit n set = write register n even if unchanged
+    uint8_t _updateDepth;   // Nesting depth of beginUpdate()
+
+    // Lock detect timing (written from the LD interrupt). The interrupt
+    // runs on the core that called begin(), which need not be the core
+    // that latches R0, so these are guarded by a hardware spinlock rather
+    // than by noInterrupts()
+    volatile uint32_t _latchTime;  // micros() when R0 was last latched
+    volatile uint32_t _lockTime;   // micros() of the first LD edge after it
+    volatile bool _lockPending;    // R0 latched, LD edge not seen yet
+    uint8_t _latchBand;            // RF divider band of the last latch
+    ADF4351LockStats _lockStats[ADF4351_BANDS];
+    spin_lock_t* _lockDetectLock;  // Claimed in begin(), NULL before
+
+    // Plan cache (least recently used replacement)
+    ADF4351PlanCacheEntry _planCache[ADF4351_PLAN_CACHE_SIZE];
+    uint8_t _planCacheCapacity;  // Entries in use (0 = cache off)
+    uint32_t _planCacheClock;    // Use counter for the LRU order
+    uint32_t _planCacheHits;
+    uint32_t _planCacheMisses;
+
+    // Lock assists
+    ADF4351Assist _fastLock;    // Fast lock policy
+    ADF4351Assist _cycleSlip;   // Cycle slip reduction policy
+    uint16_t _fastLockTime;     // Time in wide bandwidth mode (us)
+    bool _largeJump;            // Last frequency change was a large jump
+
+  private:
+    // Private methods
+    bool updateRegisters();
+    bool cachedPlan(uint32_t frequency, ADF4351Solution& solution);
+    void buildPfdCandidates();
+    static uint8_t calculateRFDivider(uint32_t frequency);
+    static uint8_t bandSelectDivider(uint32_t pfdFreq);
+    static void lockDetectIsr(void* param);
+    uint32_t lockDetectEnter();
+    void lockDetectExit(uint32_t save);
+    bool assistActive(ADF4351Assist mode);
+    bool cycleSlipActive();
+    uint32_t buildRegister2();
+    uint32_t buildRegister3();
+};
+
+// ADF4351 driver using the register transport Bus
+template <class Bus>
+class ADF4351T : public ADF4351Base {
+  public:
+    // Constructor for transports with pins chosen at run time
+    // ld_pin is the optional LD or MUXOUT connection for lock detection
+    ADF4351T(uint8_t le_pin, uint8_t clk_pin, uint8_t data_pin, uint8_t ce_pin,
+             uint8_t ld_pin = ADF4351_NO_PIN);
+
+    // Constructor for transports with compile-time pins
+    explicit ADF4351T(uint8_t ce_pin, uint8_t ld_pin = ADF4351_NO_PIN);
+
     // Initialize the ADF4351
     void begin(uint32_t refFreq = 25000000);
-    
+
     // Set output frequency in Hz
     bool setFrequency(uint32_t frequency);
-    
+
+    // Set output frequency in Hz, writing only R0 when the current PFD,
+    // RF divider, prescaler and MOD can reach it (small tuning steps)
+    // Falls back to setFrequency() otherwise, and when an AUTO lock assist
+    // has to be turned on for a large jump or off for the step after one
+    bool retune(uint32_t frequency);
+
     // Set output power level (0-3)
     // 0: -4dBm, 1: -1dBm, 2: +2dBm, 3: +5dBm
     void setPowerLevel(uint8_t level);
-    
+
     // Enable/disable output
     void enableOutput(bool enable);
-    
+
     // Set phase value (0-4095)
     void setPhase(uint16_t phase);
-    
+
     // Set low noise or low spur mode
     // true = low noise mode, false = low spur mode
     void setLowNoiseMode(bool lowNoise);
-    
-    // Get current frequency
-    uint32_t getFrequency();
-    
-    // Get lock status
-    bool isLocked();
-    
+
+    // Fast lock: wide loop bandwidth (higher charge pump current, loop
+    // filter SW pin closed) for the fast lock time after each new
+    // frequency, then the normal bandwidth. Needs a loop filter wired for it
+    void setFastLock(ADF4351Assist mode);
+
+    // Time the fast lock mode keeps the wide bandwidth, in microseconds
+    // (rounded to the fast lock timer, which counts MOD / PFD periods)
+    void setFastLockTime(uint16_t time_us);
+
+    // Cycle slip reduction: extends the PFD's linear range on large jumps
+    // It needs a PFD with 45% to 55% duty cycle and the minimum charge
+    // pump current, so the planner then prefers RDIV2 paths (the current
+    // frequency is re-planned), the charge pump drops to 0.31 mA while
+    // CSR is set, and CSR is left off where no RDIV2 path fits (see
+    // isCycleSlipAvailable())
+    void setCycleSlipReduction(ADF4351Assist mode);
+
+    // Write the step of a compiled sweep that starts at word position and
+    // return the position of the next step (0 after the last one). The
+    // driver's frequency setting is not changed; the next setter writes
+    // whatever differs from the last swept step
+    uint32_t sweepStep(const ADF4351SweepPlan& plan, uint32_t position);
+
+    // Defer register writes: setters called until the matching commit()
+    // only change the shadow registers. Calls may nest
+    void beginUpdate();
+
+    // Write everything changed since beginUpdate() as one R5 to R0
+    // sequence; it ends with R0 whenever R1 or R2 changed
+    void commit();
+
+    // Access the underlying transport
+    Bus& bus();
+
   private:
-    // Pin definitions
-    uint8_t _le_pin;   // Latch Enable Pin
-    uint8_t _clk_pin;  // Clock Pin
-    uint8_t _data_pin; // Data Pin
-    uint8_t _ce_pin;   // Chip Enable Pin
-    
-    // Current settings
-    uint32_t _frequency;    // Current frequency in Hz
-    uint32_t _refFreq;      // Reference frequency in Hz
-    uint8_t _powerLevel;    // Output power level (0-3)
-    bool _outputEnabled;    // Output state
-    bool _lowNoiseMode;     // Low noise mode state
-    
-    // Register values
-    uint32_t _registers[6]; // 6 registers, 32 bits each
-    
-    // Private methods
-    void writeRegister(uint32_t value);
-    void updateRegisters();
-    uint8_t calculateRFDivider(uint32_t frequency);
+    // Write changed and forced registers (in reverse order 5 to 0)
+    void writeRegisters();
+
+    Bus _bus;
 };
 
+// Default driver: digitalWrite bit-bang with run-time pins
+using ADF4351 = ADF4351T<ADF4351GpioBus>;
+
+template <class Bus>
+ADF4351T<Bus>::ADF4351T(uint8_t le_pin, uint8_t clk_pin, uint8_t data_pin, uint8_t ce_pin,
+                        uint8_t ld_pin)
+  : ADF4351Base(ce_pin, ld_pin), _bus(le_pin, clk_pin, data_pin) {
+}
+
+template <class Bus>
+ADF4351T<Bus>::ADF4351T(uint8_t ce_pin, uint8_t ld_pin)
+  : ADF4351Base(ce_pin, ld_pin), _bus() {
+}
+
+// Initialize the ADF4351
+template <class Bus>
+void ADF4351T<Bus>::begin(uint32_t refFreq) {
+  // Start the transport before CE, which may share the SPI MISO pin
+  _bus.begin();
+  beginRegisters(refFreq);
+  writeRegisters();
+
+  // Set a default frequency (100 MHz)
+  setFrequency(100000000);
+}
+
+// Set output frequency in Hz
+template <class Bus>
+bool ADF4351T<Bus>::setFrequency(uint32_t frequency) {
+  if (!prepareFrequency(frequency)) {
+    return false;
+  }
+
+  writeRegisters();
+  return true;
+}
+
+// Set output frequency in Hz, writing only R0 when possible
+template <class Bus>
+bool ADF4351T<Bus>::retune(uint32_t frequency) {
+  if (!prepareRetune(frequency)) {
+    return setFrequency(frequency);
+  }
+
+  writeRegisters();
+  return true;
+}
+
+// Set output power level (0-3)
+template <class Bus>
+void ADF4351T<Bus>::setPowerLevel(uint8_t level) {
+  preparePowerLevel(level);
+  writeRegisters();
+}
+
+// Enable/disable output
+template <class Bus>
+void ADF4351T<Bus>::enableOutput(bool enable) {
+  prepareOutput(enable);
+  writeRegisters();
+}
+
+// Set phase value (0-4095)
+template <class Bus>
+void ADF4351T<Bus>::setPhase(uint16_t phase) {
+  preparePhase(phase);
+  writeRegisters();
+}
+
+// Set low noise or low spur mode
+template <class Bus>
+void ADF4351T<Bus>::setLowNoiseMode(bool lowNoise) {
+  prepareLowNoiseMode(lowNoise);
+  writeRegisters();
+}
+
+// Set the fast lock policy
+template <class Bus>
+void ADF4351T<Bus>::setFastLock(ADF4351Assist mode) {
+  prepareFastLock(mode);
+  writeRegisters();
+}
+
+// Set the time spent in wide bandwidth mode
+template <class Bus>
+void ADF4351T<Bus>::setFastLockTime(uint16_t time_us) {
+  prepareFastLockTime(time_us);
+  writeRegisters();
+}
+
+// Set the cycle slip reduction policy
+template <class Bus>
+void ADF4351T<Bus>::setCycleSlipReduction(ADF4351Assist mode) {
+  prepareCycleSlipReduction(mode);
+  writeRegisters();
+}
+
+// Write one step of a compiled sweep
+template <class Bus>
+uint32_t ADF4351T<Bus>::sweepStep(const ADF4351SweepPlan& plan, uint32_t position) {
+  uint32_t count = plan.getWordCount();
+  if (position >= count) {
+    return 0;
+  }
+
+  // Stream words up to and including the step's R0 word
+  uint32_t value;
+  do {
+    value = plan.word(position++);
+    _bus.write(value);
+    _written[value & 0x07] = value;
+  } while ((value & 0x07) != 0 && position < count);
+
+  // Time the lock like any other R0 write
+  if (_ld_pin != ADF4351_NO_PIN) {
+    _bus.flush();
+    markLatch();
+  }
+
+  return position < count ? position : 0;
+}
+
+// Defer register writes until the matching commit()
+template <class Bus>
+void ADF4351T<Bus>::beginUpdate() {
+  _updateDepth++;
+}
+
+// Write everything changed since beginUpdate()
+template <class Bus>
+void ADF4351T<Bus>::commit() {
+  if (_updateDepth > 0) {
+    _updateDepth--;
+  }
+  writeRegisters();
+}
+
+// Access the underlying transport
+template <class Bus>
+Bus& ADF4351T<Bus>::bus() {
+  return _bus;
+}
+
+// Write changed and forced registers (in reverse order 5 to 0)
+template <class Bus>
+void ADF4351T<Bus>::writeRegisters() {
+  // Inside beginUpdate()/commit() the writes are collected until commit
+  if (_updateDepth > 0) {
+    return;
+  }
+
+  // R1 and R2 are double-buffered: whatever changed in them, including
+  // in a batch of deferred setters, only loads on the R0 write after it
+  if (_registers[1] != _written[1] || _registers[2] != _written[2] || (_dirty & 0x06)) {
+    _dirty |= (1 << 0);
+  }
+
+  bool latched = false;
+  for (int i = 5; i >= 0; i--) {
+    if (_registers[i] != _written[i] || (_dirty & (1 << i))) {
+      _bus.write(_registers[i]);
+      _written[i] = _registers[i];
+      latched = (i == 0);
+    }
+  }
+  _dirty = 0;
+
+  // Writing R0 restarts the lock; time it from the moment LE goes high
+  if (latched && _ld_pin != ADF4351_NO_PIN) {
+    _bus.flush();
+    markLatch();
+  }
+}
+
 #endif
@@ -0,0 +1,179 @@
+/*
+ * ADF4351_Binary.h - Binary framed control protocol for the ADF4351 sketches
+ *
+ * Frame on the wire:  COBS(payload + CRC) 0x00
+ *
+ *   payload   seq (1) | opcode (1) | arguments (little-endian)
+ *   CRC       CRC-16/CCITT-FALSE of the payload (poly 0x1021, init 0xFFFF),
+ *             low byte first
+ *
+ * COBS removes every 0x00 from the frame, so 0x00 marks the end of one and
+ * a receiver can resynchronise after any error by waiting for the next.
+ *
+ * Requests:
+ *
+ *   SET_FREQUENCY  u32 frequency (Hz)
+ *   RETUNE         u32 frequency (Hz), R0 only when possible
+ *   SET_POWER      u8 level (0-3)
+ *   OUTPUT         u8 enable
+ *   BATCH          u16 dwell (us), then up to ADF4351_BINARY_MAX_BATCH
+ *                  u32 frequencies, retuned in order with the dwell between
+ *   QUERY          no arguments
+ *   TEXT_MODE      no arguments, back to text commands after the response
+ *
+ * Every request gets one fixed-size response so a host can keep several
+ * requests in flight and match the answers by sequence number:
+ *
+ *   seq (1) | opcode (1) | status (1) | flags (1) | value u32 | aux i32
+ *
+ *   QUERY: value = frequency (Hz), aux = frequency error (mHz),
+ *          flags = ADF4351_BINARY_FLAG_*
+ *   BATCH: value = number of frequencies set
+ *   other: value = argument as applied
+ *
+ * Created: October 2026
+ */
+
+#ifndef ADF4351_BINARY_H
+#define ADF4351_BINARY_H
+
+#include <Arduino.h>
+
+// Largest number of frequencies in one BATCH request
+#ifndef ADF4351_BINARY_MAX_BATCH
+#define ADF4351_BINARY_MAX_BATCH 32
+#endif
+
+// Payload sizes
+#define ADF4351_BINARY_HEADER 2
+#define ADF4351_BINARY_RESPONSE 12
+#define ADF4351_BINARY_CRC 2
+#define ADF4351_BINARY_MAX_PAYLOAD (ADF4351_BINARY_HEADER + 2 + 4 * ADF4351_BINARY_MAX_BATCH)
+
+// Largest encoded frame, without the 0x00 delimiter (COBS adds one byte
+// per 254 plus one)
+#define ADF4351_BINARY_MAX_FRAME (ADF4351_BINARY_MAX_PAYLOAD + ADF4351_BINARY_CRC + \
+                                  (ADF4351_BINARY_MAX_PAYLOAD + ADF4351_BINARY_CRC) / 254 + 1)
+
+// Request opcodes
+enum ADF4351BinaryOpcode {
+  ADF4351_OP_SET_FREQUENCY = 0x01,
+  ADF4351_OP_RETUNE = 0x02,
+  ADF4351_OP_SET_POWER = 0x03,
+  ADF4351_OP_OUTPUT = 0x04,
+  ADF4351_OP_BATCH = 0x05,
+  ADF4351_OP_QUERY = 0x06,
+  ADF4351_OP_TEXT_MODE = 0x7F
+};
+
+// Response status
+enum ADF4351BinaryStatus {
+  ADF4351_STATUS_OK = 0,
+  ADF4351_STATUS_BAD_FRAME = 1,   // COBS, CRC or length error (seq 0)
+  ADF4351_STATUS_BAD_OPCODE = 2,
+  ADF4351_STATUS_BAD_LENGTH = 3,  // Wrong argument size for the opcode
+  ADF4351_STATUS_FAILED = 4       // Out of range or rejected by the driver
+};
+
+// QUERY response flags
+#define ADF4351_BINARY_FLAG_LOCKED 0x01
+#define ADF4351_BINARY_FLAG_OUTPUT 0x02
+#define ADF4351_BINARY_FLAG_INTEGER_N 0x04
+
+class ADF4351Binary {
+  public:
+    // CRC-16/CCITT-FALSE
+    static uint16_t crc16(const uint8_t* data, uint16_t length) {
+      uint16_t crc = 0xFFFF;
+      for (uint16_t i = 0; i < length; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+          crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+      }
+      return crc;
+    }
+
+    // COBS encode length bytes into out (length + length / 254 + 1 bytes)
+    // Returns the encoded length, without the 0x00 delimiter
+    static uint16_t encode(const uint8_t* data, uint16_t length, uint8_t* out) {
+      uint16_t codeIndex = 0;
+      uint16_t write = 1;
+      uint8_t code = 1;
+      for (uint16_t i = 0; i < length; i++) {
+        if (data[i] == 0) {
+          out[codeIndex] = code;
+          codeIndex = write++;
+          code = 1;
+        } else {
+          out[write++] = data[i];
+          code++;
+          if (code == 0xFF) {
+            out[codeIndex] = code;
+            codeIndex = write++;
+            code = 1;
+          }
+        }
+      }
+      out[codeIndex] = code;
+      return write;
+    }
+
+    // COBS decode a frame (delimiter removed) in place
+    // Returns the decoded length, or 0 if the frame is malformed
+    static uint16_t decode(uint8_t* frame, uint16_t length) {
+      uint16_t read = 0;
+      uint16_t write = 0;
+      while (read < length) {
+        uint8_t code = frame[read++];
+        if (code == 0 || read + code - 1 > length) {
+          return 0;
+        }
+        for (uint8_t i = 1; i < code; i++) {
+          frame[write++] = frame[read++];
+        }
+        if (code < 0xFF && read < length) {
+          frame[write++] = 0;
+        }
+      }
+      return write;
+    }
+
+    // Little-endian field access
+    static uint16_t get16(const uint8_t* p) {
+      return (uint16_t)p[0] | ((uint16_t)p[1] << 8);
+    }
+
+    static uint32_t get32(const uint8_t* p) {
+      return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+
+    static void put32(uint8_t* p, uint32_t value) {
+      p[0] = (uint8_t)value;
+      p[1] = (uint8_t)(value >> 8);
+      p[2] = (uint8_t)(value >> 16);
+      p[3] = (uint8_t)(value >> 24);
+    }
+
+    // Build a complete response frame including the 0x00 delimiter into
+    // out (at least ADF4351_BINARY_RESPONSE + 4 bytes); returns its length
+    static uint8_t response(uint8_t* out, uint8_t seq, uint8_t opcode, uint8_t status,
+                            uint8_t flags, uint32_t value, int32_t aux) {
+      uint8_t payload[ADF4351_BINARY_RESPONSE + ADF4351_BINARY_CRC];
+      payload[0] = seq;
+      payload[1] = opcode;
+      payload[2] = status;
+      payload[3] = flags;
+      put32(payload + 4, value);
+      put32(payload + 8, (uint32_t)aux);
+      uint16_t crc = crc16(payload, ADF4351_BINARY_RESPONSE);
+      payload[ADF4351_BINARY_RESPONSE] = (uint8_t)crc;
+      payload[ADF4351_BINARY_RESPONSE + 1] = (uint8_t)(crc >> 8);
+
+      uint8_t length = encode(payload, sizeof(payload), out);
+      out[length++] = 0;
+      return length;
+    }
+};
+
+#endif
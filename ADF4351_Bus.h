@@ -0,0 +1,245 @@
+/*
+ * ADF4351_Bus.h - Register transport policies for the ADF4351 library
+ *
+ * Each policy shifts complete 32-bit register words into the ADF4351 and
+ * provides the same three calls:
+ *
+ *   void begin();                 // configure pins / peripheral
+ *   void write(uint32_t value);   // send one word and strobe LE
+ *   void flush();                 // wait until queued words are latched
+ *
+ * The compile-time policies take their pins as template arguments so the
+ * write path inlines to direct SIO/SPI/PIO accesses with no per-bit lookup.
+ *
+ * Created: October 2026
+ */
+
+#ifndef ADF4351_BUS_H
+#define ADF4351_BUS_H
+
+#include <Arduino.h>
+#include <SPI.h>
+#include <hardware/gpio.h>
+#include "ADF4351_PIO.h"
+
+// Serial clock rate for the hardware SPI transport (Hz)
+// The ADF4351 accepts up to 20 MHz; the SPI block rounds down from this
+#ifndef ADF4351_SPI_CLOCK
+#define ADF4351_SPI_CLOCK 20000000
+#endif
+
+// Number of words ADF4351MockBus keeps (later words are only counted)
+#ifndef ADF4351_MOCK_CAPACITY
+#define ADF4351_MOCK_CAPACITY 64
+#endif
+
+// Compile-time busy wait of N cycles
+template <uint8_t N>
+struct ADF4351Delay {
+  static inline __attribute__((always_inline)) void wait() {
+    __asm__ volatile("nop");
+    ADF4351Delay<N - 1>::wait();
+  }
+};
+
+template <>
+struct ADF4351Delay<0> {
+  static inline __attribute__((always_inline)) void wait() {}
+};
+
+// digitalWrite bit-bang on pins chosen at run time (original behaviour)
+class ADF4351GpioBus {
+  public:
+    ADF4351GpioBus(uint8_t le_pin, uint8_t clk_pin, uint8_t data_pin)
+      : _le_pin(le_pin), _clk_pin(clk_pin), _data_pin(data_pin) {}
+
+    void begin() {
+      pinMode(_le_pin, OUTPUT);
+      pinMode(_clk_pin, OUTPUT);
+      pinMode(_data_pin, OUTPUT);
+
+      // Set initial pin states
+      digitalWrite(_le_pin, HIGH);
+      digitalWrite(_clk_pin, LOW);
+      digitalWrite(_data_pin, LOW);
+    }
+
+    void write(uint32_t value) {
+      // Pull LE low to begin the transfer
+      digitalWrite(_le_pin, LOW);
+
+      // Send 32 bits, MSB first
+      for (int i = 31; i >= 0; i--) {
+        // Set DATA pin based on bit value
+        digitalWrite(_data_pin, (value >> i) & 0x01);
+
+        // Pulse the clock
+        digitalWrite(_clk_pin, HIGH);
+        delayMicroseconds(1);
+        digitalWrite(_clk_pin, LOW);
+        delayMicroseconds(1);
+      }
+
+      // Pull LE high to latch the data
+      digitalWrite(_le_pin, HIGH);
+      delayMicroseconds(1);
+    }
+
+    void flush() {}
+
+  private:
+    uint8_t _le_pin;   // Latch Enable Pin
+    uint8_t _clk_pin;  // Clock Pin
+    uint8_t _data_pin; // Data Pin
+};
+
+// Bit-bang through the SIO set/clear registers with compile-time pins
+// DELAY is the number of cycles each CLK phase is held; the default of
+// 4 keeps t4/t5 >= 25 ns at the RP2350's 150 MHz system clock
+template <uint8_t LE, uint8_t CLK, uint8_t DATA, uint8_t DELAY = 4>
+class ADF4351SioBus {
+  static_assert(LE < 32 && CLK < 32 && DATA < 32, "ADF4351SioBus pins must be GPIO 0-31");
+
+  public:
+    void begin() {
+      gpio_init_mask(LE_MASK | CLK_MASK | DATA_MASK);
+      gpio_set_mask(LE_MASK);
+      gpio_clr_mask(CLK_MASK | DATA_MASK);
+      gpio_set_dir_out_masked(LE_MASK | CLK_MASK | DATA_MASK);
+    }
+
+    inline void write(uint32_t value) {
+      gpio_clr_mask(LE_MASK);
+
+      // Send 32 bits, MSB first; DATA is updated without a branch
+      for (int i = 31; i >= 0; i--) {
+        gpio_put_masked(DATA_MASK, ((value >> i) & 0x01) << DATA);
+        ADF4351Delay<DELAY>::wait();
+        gpio_set_mask(CLK_MASK);
+        ADF4351Delay<DELAY>::wait();
+        gpio_clr_mask(CLK_MASK);
+      }
+
+      ADF4351Delay<DELAY>::wait();
+      gpio_set_mask(LE_MASK);
+      ADF4351Delay<DELAY>::wait();
+    }
+
+    void flush() {}
+
+  private:
+    static const uint32_t LE_MASK = 1u << LE;
+    static const uint32_t CLK_MASK = 1u << CLK;
+    static const uint32_t DATA_MASK = 1u << DATA;
+};
+
+// Hardware SPI: 4 bytes MSB first, LE driven through SIO
+// CLK must be an SCK pin and DATA a TX pin of the same SPI block; the GPIO
+// function select puts the role in the low 2 bits (2 = SCK, 3 = TX) and
+// the block in bit 3, e.g. GPIO 2/3 are SPI0 and GPIO 10/11 are SPI1
+template <uint8_t LE, uint8_t CLK, uint8_t DATA, uint32_t CLOCK = ADF4351_SPI_CLOCK>
+class ADF4351SpiBus {
+  static_assert((CLK & 0x03) == 2, "ADF4351SpiBus CLK must be an SPI SCK pin");
+  static_assert((DATA & 0x03) == 3, "ADF4351SpiBus DATA must be an SPI TX pin");
+  static_assert(((CLK >> 3) & 0x01) == ((DATA >> 3) & 0x01), "ADF4351SpiBus CLK and DATA must share an SPI block");
+  static_assert(LE < 32, "ADF4351SpiBus LE must be GPIO 0-31");
+
+  public:
+    void begin() {
+      port().setSCK(CLK);
+      port().setTX(DATA);
+      port().begin();
+
+      gpio_init(LE);
+      gpio_put(LE, 1);
+      gpio_set_dir(LE, true);
+    }
+
+    inline void write(uint32_t value) {
+      gpio_put(LE, 0);
+      port().beginTransaction(SPISettings(CLOCK, MSBFIRST, SPI_MODE0));
+      for (int i = 24; i >= 0; i -= 8) {
+        port().transfer((uint8_t)(value >> i));
+      }
+      port().endTransaction();
+      gpio_put(LE, 1);
+    }
+
+    void flush() {}
+
+  private:
+    static inline SPIClassRP2040& port() {
+      return ((CLK >> 3) & 0x01) ? SPI1 : SPI;
+    }
+};
+
+// PIO state machine (see ADF4351_PIO.cpp); falls back to SIO bit-bang on
+// the same pins if no PIO block has room for the program
+template <uint8_t LE, uint8_t CLK, uint8_t DATA, uint32_t CLOCK = ADF4351_PIO_CLOCK>
+class ADF4351PioBus {
+  public:
+    ADF4351PioBus() : _active(false) {}
+
+    void begin() {
+      _active = _pio.begin(LE, CLK, DATA, CLOCK);
+      if (!_active) {
+        _fallback.begin();
+      }
+    }
+
+    inline void write(uint32_t value) {
+      if (_active) {
+        _pio.write(value);
+      } else {
+        _fallback.write(value);
+      }
+    }
+
+    void flush() {
+      if (_active) {
+        _pio.flush();
+      }
+    }
+
+    // True if the PIO engine is running (false: SIO fallback)
+    bool isActive() { return _active; }
+
+  private:
+    ADF4351Pio _pio;
+    ADF4351SioBus<LE, CLK, DATA> _fallback;
+    bool _active;
+};
+
+// Records every word instead of driving pins (dry runs and bench checks)
+class ADF4351MockBus {
+  public:
+    ADF4351MockBus() : _count(0) {}
+
+    // Accepts the legacy pin arguments so it can stand in for ADF4351GpioBus
+    ADF4351MockBus(uint8_t, uint8_t, uint8_t) : _count(0) {}
+
+    void begin() { _count = 0; }
+
+    void write(uint32_t value) {
+      if (_count < ADF4351_MOCK_CAPACITY) {
+        _words[_count] = value;
+      }
+      _count++;
+    }
+
+    void flush() {}
+
+    // Number of words written since begin()/clear()
+    uint32_t count() { return _count; }
+
+    // Recorded word i (0 if it was beyond the capacity)
+    uint32_t word(uint32_t i) { return i < ADF4351_MOCK_CAPACITY ? _words[i] : 0; }
+
+    void clear() { _count = 0; }
+
+  private:
+    uint32_t _words[ADF4351_MOCK_CAPACITY];
+    uint32_t _count;
+};
+
+#endif
@@ -0,0 +1,238 @@
+/*
+ * ADF4351_Commands.h - Table driven text command dispatch for the ADF4351
+ * sketches
+ *
+ * A sketch lists its commands once, with the argument each one takes and
+ * the function that handles it:
+ *
+ *   void cmdFreq(const ADF4351CommandArgs& args);
+ *   void cmdStatus(const ADF4351CommandArgs& args);
+ *
+ *   constexpr ADF4351CommandSpec COMMAND_SPECS[] = {
+ *     {"freq", ADF4351_ARG_MHZ, cmdFreq},
+ *     {"status", ADF4351_ARG_NONE, cmdStatus},
+ *   };
+ *   constexpr ADF4351CommandTable commands(COMMAND_SPECS);
+ *   static_assert(commands.isPerfect(), "Command names must be unique");
+ *
+ *   ADF4351LineBuffer<64> input;
+ *   void loop() {
+ *     while (Serial.available()) {
+ *       if (input.feed(Serial.read()) == ADF4351_LINE_READY) {
+ *         commands.execute(input.line());
+ *       }
+ *     }
+ *   }
+ *
+ * The table is hashed at compile time: the constructor searches for a
+ * seed under which every name lands in its own slot, so a lookup is one
+ * hash of the typed name and one strcmp however many commands there are.
+ * The search fails only for repeated names, which the static_assert turns
+ * into a build error.
+ *
+ * Created: October 2026
+ */
+
+#ifndef ADF4351_COMMANDS_H
+#define ADF4351_COMMANDS_H
+
+#include <Arduino.h>
+#include "ADF4351_Text.h"
+
+// Argument a command takes
+enum ADF4351ArgType {
+  ADF4351_ARG_NONE,  // No argument
+  ADF4351_ARG_UINT,  // Unsigned integer, in value
+  ADF4351_ARG_MHZ,   // Decimal MHz (up to 6 fraction digits), in value as Hz
+  ADF4351_ARG_TEXT   // Rest of the line, in text
+};
+
+// Flag for ADF4351ArgType: the argument may be left out
+#define ADF4351_ARG_OPTIONAL 0x80
+
+// Result of ADF4351CommandTable::parse() / execute()
+enum ADF4351ParseResult {
+  ADF4351_PARSE_OK,
+  ADF4351_PARSE_EMPTY,         // Blank line
+  ADF4351_PARSE_UNKNOWN,       // No command of that name
+  ADF4351_PARSE_BAD_ARGUMENT   // Missing, extra or malformed argument
+};
+
+// Parsed argument handed to a command handler
+struct ADF4351CommandArgs {
+  bool present;       // An argument was given
+  uint32_t value;     // ADF4351_ARG_UINT / ADF4351_ARG_MHZ
+  const char* text;   // Argument as typed (lower case), "" if none
+};
+
+typedef void (*ADF4351CommandHandler)(const ADF4351CommandArgs& args);
+
+// One command: lower case name, ADF4351ArgType (| ADF4351_ARG_OPTIONAL)
+// and handler
+struct ADF4351CommandSpec {
+  const char* name;
+  uint8_t arg;
+  ADF4351CommandHandler handler;
+};
+
+// Longest seed search before the table is reported as not perfect
+#define ADF4351_COMMAND_SEED_TRIES 4096
+
+template <size_t N>
+class ADF4351CommandTable {
+  static_assert(N > 0 && N < 255, "ADF4351CommandTable holds 1-254 commands");
+
+  public:
+    // Slot count: a power of two of at least four per command keeps the
+    // seed search short
+    static constexpr uint16_t SLOTS = N * 4 <= 16 ? 16 : N * 4 <= 64 ? 64 : N * 4 <= 256 ? 256 : 1024;
+
+    // Build the hash over the commands; usable in a constant expression
+    constexpr ADF4351CommandTable(const ADF4351CommandSpec (&specs)[N])
+      : _specs(specs), _seed(0), _perfect(false), _slots() {
+      for (uint32_t seed = 1; seed <= ADF4351_COMMAND_SEED_TRIES && !_perfect; seed++) {
+        _perfect = place(seed);
+      }
+    }
+
+    // True if every name has a slot of its own
+    constexpr bool isPerfect() const { return _perfect; }
+
+    // Seed found for the hash
+    constexpr uint32_t getSeed() const { return _seed; }
+
+    // Find the command named name, or NULL
+    const ADF4351CommandSpec* find(const char* name) const {
+      uint8_t index = _slots[slot(hash(_seed, name))];
+      if (index == 0 || strcmp(_specs[index - 1].name, name) != 0) {
+        return NULL;
+      }
+      return &_specs[index - 1];
+    }
+
+    // Lower-case and split line in place, look up the command and parse
+    // its argument into args; spec is set when the name is known
+    uint8_t parse(char* line, const ADF4351CommandSpec*& spec, ADF4351CommandArgs& args) const {
+      char* tokens[2] = {NULL, NULL};
+      ADF4351Text::toLower(line);
+      uint8_t count = ADF4351Text::tokenize(line, tokens, 2);
+      spec = NULL;
+      if (count == 0) {
+        return ADF4351_PARSE_EMPTY;
+      }
+
+      spec = find(tokens[0]);
+      if (spec == NULL) {
+        return ADF4351_PARSE_UNKNOWN;
+      }
+
+      args.present = count == 2;
+      args.value = 0;
+      args.text = args.present ? tokens[1] : "";
+
+      uint8_t type = spec->arg & ~ADF4351_ARG_OPTIONAL;
+      if (!args.present) {
+        return type == ADF4351_ARG_NONE || (spec->arg & ADF4351_ARG_OPTIONAL) ? ADF4351_PARSE_OK : ADF4351_PARSE_BAD_ARGUMENT;
+      }
+      switch (type) {
+        case ADF4351_ARG_UINT:
+          return ADF4351Text::parseUint(args.text, args.value) ? ADF4351_PARSE_OK : ADF4351_PARSE_BAD_ARGUMENT;
+        case ADF4351_ARG_MHZ:
+          return ADF4351Text::parseDecimal(args.text, 6, args.value) ? ADF4351_PARSE_OK : ADF4351_PARSE_BAD_ARGUMENT;
+        case ADF4351_ARG_TEXT:
+          return ADF4351_PARSE_OK;
+        default:
+          return ADF4351_PARSE_BAD_ARGUMENT;
+      }
+    }
+
+    // Parse line and run the command's handler if it parsed
+    uint8_t execute(char* line) const {
+      const ADF4351CommandSpec* spec;
+      ADF4351CommandArgs args;
+      uint8_t result = parse(line, spec, args);
+      if (result == ADF4351_PARSE_OK) {
+        spec->handler(args);
+      }
+      return result;
+    }
+
+    // FNV-1a, starting from a seed dependent basis
+    static constexpr uint32_t hash(uint32_t seed, const char* name) {
+      uint32_t h = 2166136261UL ^ (seed * 0x9E3779B9UL);
+      for (; *name != '\0'; name++) {
+        h = (h ^ (uint8_t)*name) * 16777619UL;
+      }
+      return h;
+    }
+
+  private:
+    static constexpr uint16_t slot(uint32_t h) {
+      return (h ^ (h >> 15)) & (SLOTS - 1);
+    }
+
+    // Try to give every command its own slot under seed
+    constexpr bool place(uint32_t seed) {
+      for (uint16_t i = 0; i < SLOTS; i++) {
+        _slots[i] = 0;
+      }
+      for (size_t i = 0; i < N; i++) {
+        uint16_t s = slot(hash(seed, _specs[i].name));
+        if (_slots[s] != 0) {
+          return false;
+        }
+        _slots[s] = i + 1;
+      }
+      _seed = seed;
+      return true;
+    }
+
+    const ADF4351CommandSpec* _specs;
+    uint32_t _seed;
+    bool _perfect;
+    uint8_t _slots[SLOTS];  // Command index + 1 per slot, 0 if empty
+};
+
+// Result of ADF4351LineBuffer::feed()
+enum ADF4351LineResult {
+  ADF4351_LINE_NONE,      // Character stored, line not complete
+  ADF4351_LINE_READY,     // line() holds a complete line
+  ADF4351_LINE_OVERFLOW   // The line was too long and has been dropped
+};
+
+// Fixed buffer collecting serial characters into lines
+template <uint8_t SIZE>
+class ADF4351LineBuffer {
+  public:
+    ADF4351LineBuffer() : _length(0), _overflow(false) {
+      _buffer[0] = '\0';
+    }
+
+    // Add one character; a CR or LF ends the line
+    uint8_t feed(char c) {
+      if (c == '\n' || c == '\r') {
+        uint8_t result = _overflow ? ADF4351_LINE_OVERFLOW : _length > 0 ? ADF4351_LINE_READY : ADF4351_LINE_NONE;
+        _buffer[_length] = '\0';
+        _length = 0;
+        _overflow = false;
+        return result;
+      }
+      if (_length < SIZE - 1) {
+        _buffer[_length++] = c;
+      } else {
+        // Drop the rest of an over-long line
+        _overflow = true;
+      }
+      return ADF4351_LINE_NONE;
+    }
+
+    // Line completed by the last feed() (modifiable in place)
+    char* line() { return _buffer; }
+
+  private:
+    char _buffer[SIZE];
+    uint8_t _length;
+    bool _overflow;
+};
+
+#endif
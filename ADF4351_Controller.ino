@@ -6,30 +6,84 @@
  * 
  * Connections:
  * ADF4351 LE (Latch Enable) -> Pico GPIO 5
- * ADF4351 CLK (Clock) -> Pico GPIO 2
- * ADF4351 DATA (Data) -> Pico GPIO 3
+ * ADF4351 CLK (Clock) -> Pico GPIO 2 (SPI0 SCK)
+ * ADF4351 DATA (Data) -> Pico GPIO 3 (SPI0 TX)
  * ADF4351 CE (Chip Enable) -> Pico GPIO 4
+ * ADF4351 LD (Lock Detect) -> Pico GPIO 6 (optional)
  * 
  * Created: March 2025
  */
 
 #include "ADF4351.h"
+#include "ADF4351_Engine.h"
+#include "ADF4351_Commands.h"
+#include "ADF4351_Binary.h"
+#include "ADF4351_Output.h"
+#include "ADF4351_Scpi.h"
 
 // Pin definitions
 #define ADF4351_LE_PIN   5  // Latch Enable Pin
 #define ADF4351_CLK_PIN  2  // Clock Pin
 #define ADF4351_DATA_PIN 3  // Data Pin
 #define ADF4351_CE_PIN   4  // Chip Enable Pin
+#define ADF4351_LD_PIN   6  // Lock Detect Pin (LD or MUXOUT)
+
+// Run register writes on core 1, fed through the command queue
+// (0 = everything on core 0)
+#define USE_CORE1 1
+
+// How long a command may wait in the queue before it is reported lost (us)
+#define COMMAND_TIMEOUT_US 100000
+
+// Start with SCPI commands instead of the text commands (1 = no banner,
+// for test automation)
+#define SCPI_AT_STARTUP 0
+
+// How long *OPC? waits for the PLL to lock after the last latch (us)
+#define SCPI_LOCK_TIMEOUT_US 10000
 
 // Reference frequency (Hz)
 const uint32_t REF_FREQ = 25000000; // 25 MHz reference
 
+// Register transport: hardware SPI writes a word in a few us where the
+// digitalWrite bit-bang takes ~70 us, too slow for short sweep dwells
+typedef ADF4351SpiBus<ADF4351_LE_PIN, ADF4351_CLK_PIN, ADF4351_DATA_PIN> ControllerBus;
+
 // Create ADF4351 instance
-ADF4351 adf4351(ADF4351_LE_PIN, ADF4351_CLK_PIN, ADF4351_DATA_PIN, ADF4351_CE_PIN);
+ADF4351T<ControllerBus> adf4351(ADF4351_CE_PIN, ADF4351_LD_PIN);
+
+// Queued serial output, drained from loop() without blocking
+ADF4351Output<4096> output(Serial);
+
+// Command queue / executor for the synthesizer
+ADF4351Engine<ControllerBus> engine(adf4351);
 
-// Command processing variables
-String inputBuffer = "";
-bool commandComplete = false;
+// Command processing variables: fixed line buffer, split in place
+// (room for several ';' separated SCPI commands)
+#define INPUT_BUFFER_SIZE 128
+ADF4351LineBuffer<INPUT_BUFFER_SIZE> input;
+
+// Binary protocol (entered with the "binary" command)
+bool binaryMode = false;
+uint8_t frameBuffer[ADF4351_BINARY_MAX_FRAME];
+uint16_t frameLength = 0;
+bool frameOverflow = false;
+
+// SCPI mode (entered with the "scpi" command) and its sweep settings
+bool scpiMode = SCPI_AT_STARTUP;
+uint32_t sweepStart = 100000000;  // 100 MHz
+uint32_t sweepStop = 200000000;   // 200 MHz
+uint32_t sweepStep = 1000000;     // 1 MHz
+uint32_t sweepDwell = 1000;       // 1 ms per step (us)
+bool sweepOn = false;
+
+// Sweep plan run by the engine's timer (16 KB)
+#define SWEEP_MAX_WORDS 4096
+uint32_t sweepWords[SWEEP_MAX_WORDS];
+ADF4351SweepPlan sweepPlan(sweepWords, SWEEP_MAX_WORDS);
+
+// Cycles spent lower-casing, looking up and argument parsing the last command
+uint32_t lastParseCycles = 0;
 
 void setup() {
   // Initialize serial communication
@@ -38,156 +92,777 @@ void setup() {
     ; // Wait for serial port to connect
   }
   
-  Serial.println("ADF4351 Controller for Raspberry Pi Pico 2");
-  Serial.println("----------------------------------------");
-  
   // Initialize ADF4351
   adf4351.begin(REF_FREQ);
   
   // Set initial frequency (100 MHz)
   adf4351.setFrequency(100000000);
   
-  Serial.println("ADF4351 initialized");
+  // SCPI sessions start without a banner
+  if (scpiMode) {
+    return;
+  }
+  
+  output.println("ADF4351 Controller for Raspberry Pi Pico 2");
+  output.println("----------------------------------------");
+  output.println("ADF4351 initialized");
   printHelp();
 }
 
+#if USE_CORE1
+// Core 1 only executes synthesizer commands; sweep steps fire here too
+void setup1() {
+  engine.begin();
+}
+
+void loop1() {
+  engine.poll();
+}
+#endif
+
+// Run a synthesizer command on the engine's core; false if it was lost
+// or the driver rejected it. Text, SCPI and binary settings all come
+// through here, so any of them ends a running sweep first
+bool submitCommand(uint8_t type, uint32_t value, uint32_t arg) {
+  if (type != ADF4351_CMD_SWEEP_START && type != ADF4351_CMD_SWEEP_STOP) {
+    stopSweep();
+  }
+  
+#if USE_CORE1
+  uint32_t failed = engine.getFailed();
+  uint32_t seq = engine.post(type, value, arg);
+  return seq != 0 && engine.waitFor(seq, COMMAND_TIMEOUT_US) && engine.getFailed() == failed;
+#else
+  ADF4351Command command = {type, value, arg};
+  return engine.execute(command);
+#endif
+}
+
+bool submit(uint8_t type, uint32_t value) {
+  return submitCommand(type, value, 0);
+}
+
 void loop() {
+  // Send queued output as the port takes it
+  output.drain();
+  
   // Process serial commands
   while (Serial.available()) {
     char c = Serial.read();
     
+    // Binary frames end at 0x00
+    if (binaryMode) {
+      receiveFrameByte((uint8_t)c);
+      continue;
+    }
+    
     // Process on newline
-    if (c == '\n' || c == '\r') {
-      if (inputBuffer.length() > 0) {
-        processCommand(inputBuffer);
-        inputBuffer = "";
+    uint8_t result = input.feed(c);
+    if (result == ADF4351_LINE_READY) {
+      if (scpiMode) {
+        processScpi(input.line());
+      } else {
+        processCommand(input.line());
+      }
+    } else if (result == ADF4351_LINE_OVERFLOW) {
+      if (scpiMode) {
+        processScpiOverflow();
+      } else {
+        output.println("Error: Command too long");
       }
-    } else {
-      // Add character to buffer
-      inputBuffer += c;
     }
   }
 }
 
-void processCommand(String command) {
-  command.trim();
-  command.toLowerCase();
+// Set frequency command: "freq 145000000"
+void cmdFreq(const ADF4351CommandArgs& args) {
+  uint32_t frequency = args.value;
   
-  // Parse command
-  if (command.startsWith("freq ")) {
-    // Set frequency command: "freq 145000000"
-    String freqStr = command.substring(5);
-    uint32_t frequency = freqStr.toInt();
+  if (frequency >= 35000000) {
+    output.print("Setting frequency to: ");
+    output.print(frequency);
+    output.println(" Hz");
     
-    if (frequency >= 35000000 && frequency <= 4400000000UL) {
-      Serial.print("Setting frequency to: ");
-      Serial.print(frequency);
-      Serial.println(" Hz");
-      
-      if (adf4351.setFrequency(frequency)) {
-        Serial.println("Frequency set successfully");
-      } else {
-        Serial.println("Error: Frequency out of range");
-      }
+    if (submit(ADF4351_CMD_SET_FREQUENCY, frequency)) {
+      output.println("Frequency set successfully");
     } else {
-      Serial.println("Error: Frequency out of range (35 MHz to 4.4 GHz)");
+      output.println("Error: Frequency out of range");
     }
-  } 
-  else if (command.startsWith("power ")) {
-    // Set power level command: "power 3"
-    String powerStr = command.substring(6);
-    uint8_t powerLevel = powerStr.toInt();
+  } else {
+    output.println("Error: Frequency out of range (35 MHz to 4.4 GHz)");
+  }
+}
+
+// Set power level command: "power 3"
+void cmdPower(const ADF4351CommandArgs& args) {
+  uint8_t powerLevel = args.value;
+  
+  if (args.value <= 3) {
+    output.print("Setting power level to: ");
+    output.println(powerLevel);
+    submit(ADF4351_CMD_SET_POWER, powerLevel);
     
-    if (powerLevel <= 3) {
-      Serial.print("Setting power level to: ");
-      Serial.println(powerLevel);
-      adf4351.setPowerLevel(powerLevel);
-      
-      // Print corresponding dBm value
-      int8_t dBm = -4 + (powerLevel * 3);
-      Serial.print("Output power: ");
-      Serial.print(dBm);
-      Serial.println(" dBm");
-    } else {
-      Serial.println("Error: Power level must be 0-3");
-      Serial.println("0: -4dBm, 1: -1dBm, 2: +2dBm, 3: +5dBm");
-    }
+    // Print corresponding dBm value
+    int8_t dBm = -4 + (powerLevel * 3);
+    output.print("Output power: ");
+    output.print(dBm);
+    output.println(" dBm");
+  } else {
+    output.println("Error: Power level must be 0-3");
+    output.println("0: -4dBm, 1: -1dBm, 2: +2dBm, 3: +5dBm");
   }
-  else if (command == "on") {
-    // Enable output
-    Serial.println("Enabling RF output");
-    adf4351.enableOutput(true);
+}
+
+// Enable output
+void cmdOn(const ADF4351CommandArgs& args) {
+  output.println("Enabling RF output");
+  submit(ADF4351_CMD_OUTPUT, 1);
+}
+
+// Disable output
+void cmdOff(const ADF4351CommandArgs& args) {
+  output.println("Disabling RF output");
+  submit(ADF4351_CMD_OUTPUT, 0);
+}
+
+// Set phase command: "phase 90"
+void cmdPhase(const ADF4351CommandArgs& args) {
+  uint16_t phase = args.value;
+  
+  if (args.value <= 4095) {
+    output.print("Setting phase to: ");
+    output.println(phase);
+    submit(ADF4351_CMD_SET_PHASE, phase);
+  } else {
+    output.println("Error: Phase must be 0-4095");
   }
-  else if (command == "off") {
-    // Disable output
-    Serial.println("Disabling RF output");
-    adf4351.enableOutput(false);
+}
+
+// Set low noise mode
+void cmdLowNoise(const ADF4351CommandArgs& args) {
+  output.println("Setting low noise mode");
+  submit(ADF4351_CMD_LOW_NOISE, 1);
+}
+
+// Set low spur mode
+void cmdLowSpur(const ADF4351CommandArgs& args) {
+  output.println("Setting low spur mode");
+  submit(ADF4351_CMD_LOW_NOISE, 0);
+}
+
+// Set fast lock policy: "fastlock auto"
+void cmdFastLock(const ADF4351CommandArgs& args) {
+  ADF4351Assist mode;
+  if (parseAssist(args.text, mode)) {
+    submit(ADF4351_CMD_FAST_LOCK, mode);
+    output.print("Fast lock: ");
+    output.println(args.text);
+  } else {
+    output.println("Error: Use fastlock off, on or auto");
   }
-  else if (command.startsWith("phase ")) {
-    // Set phase command: "phase 90"
-    String phaseStr = command.substring(6);
-    uint16_t phase = phaseStr.toInt();
+}
+
+// Set cycle slip reduction policy: "csr auto"
+void cmdCycleSlip(const ADF4351CommandArgs& args) {
+  ADF4351Assist mode;
+  if (parseAssist(args.text, mode)) {
+    submit(ADF4351_CMD_CYCLE_SLIP, mode);
+    output.print("Cycle slip reduction: ");
+    output.println(args.text);
     
-    if (phase <= 4095) {
-      Serial.print("Setting phase to: ");
-      Serial.println(phase);
-      adf4351.setPhase(phase);
-    } else {
-      Serial.println("Error: Phase must be 0-4095");
+    // CSR needs a reference path through RDIV2, which not every
+    // frequency has at the channel resolution
+    if (mode != ADF4351_ASSIST_OFF && !adf4351.isCycleSlipAvailable()) {
+      output.println("Warning: no RDIV2 reference path at this frequency, CSR stays off");
     }
+  } else {
+    output.println("Error: Use csr off, on or auto");
+  }
+}
+
+// Print current status
+void cmdStatus(const ADF4351CommandArgs& args) {
+  printStatus();
+}
+
+// Print or clear lock time statistics: "stats", "stats clear"
+void cmdStats(const ADF4351CommandArgs& args) {
+  if (!args.present) {
+    printLockStats();
+  } else if (strcmp(args.text, "clear") == 0) {
+    adf4351.clearLockStats();
+    output.println("Lock statistics cleared");
+  } else {
+    output.println("Error: Use stats or stats clear");
+  }
+}
+
+// Switch to the binary protocol until a TEXT_MODE frame
+void cmdBinary(const ADF4351CommandArgs& args) {
+  output.println("OK binary");
+  binaryMode = true;
+  frameLength = 0;
+  frameOverflow = false;
+}
+
+// Switch to SCPI commands until SYSTem:TEXT
+void cmdScpi(const ADF4351CommandArgs& args) {
+  output.println("OK scpi");
+  scpiMode = true;
+}
+
+// Print help
+void cmdHelp(const ADF4351CommandArgs& args) {
+  printHelp();
+}
+
+// Command table, hashed at compile time
+constexpr ADF4351CommandSpec COMMAND_SPECS[] = {
+  {"freq", ADF4351_ARG_UINT, cmdFreq},
+  {"power", ADF4351_ARG_UINT, cmdPower},
+  {"on", ADF4351_ARG_NONE, cmdOn},
+  {"off", ADF4351_ARG_NONE, cmdOff},
+  {"phase", ADF4351_ARG_UINT, cmdPhase},
+  {"lownoise", ADF4351_ARG_NONE, cmdLowNoise},
+  {"lowspur", ADF4351_ARG_NONE, cmdLowSpur},
+  {"fastlock", ADF4351_ARG_TEXT, cmdFastLock},
+  {"csr", ADF4351_ARG_TEXT, cmdCycleSlip},
+  {"status", ADF4351_ARG_NONE, cmdStatus},
+  {"stats", ADF4351_ARG_TEXT | ADF4351_ARG_OPTIONAL, cmdStats},
+  {"binary", ADF4351_ARG_NONE, cmdBinary},
+  {"scpi", ADF4351_ARG_NONE, cmdScpi},
+  {"help", ADF4351_ARG_NONE, cmdHelp}
+};
+constexpr ADF4351CommandTable commands(COMMAND_SPECS);
+static_assert(commands.isPerfect(), "Command names must be unique");
+
+void processCommand(char* line) {
+  uint32_t parseStart = rp2040.getCycleCount();
+  
+  // Look up the command and parse its argument
+  const ADF4351CommandSpec* spec;
+  ADF4351CommandArgs args;
+  uint8_t result = commands.parse(line, spec, args);
+  
+  lastParseCycles = rp2040.getCycleCount() - parseStart;
+  
+  if (result == ADF4351_PARSE_OK) {
+    spec->handler(args);
+  } else if (result == ADF4351_PARSE_BAD_ARGUMENT) {
+    output.print("Error: Invalid argument for '");
+    output.print(spec->name);
+    output.println("'. Type 'help' for usage.");
+  } else if (result == ADF4351_PARSE_UNKNOWN) {
+    output.println("Unknown command. Type 'help' for available commands.");
+  }
+}
+
+// Stop a running sweep so a new setting is not overwritten by its steps
+void stopSweep() {
+  if (sweepOn) {
+    submit(ADF4351_CMD_SWEEP_STOP, 0);
+    sweepOn = false;
+  }
+}
+
+// *IDN?: manufacturer, model, serial number, firmware
+int16_t scpiIdn(const char* parameter, Print& response) {
+  response.print("ADF4351,Pico 2 Controller,0,1.0");
+  return ADF4351_SCPI_NO_ERROR;
+}
+
+// *RST: sweep off, 100 MHz, +5 dBm, output on
+int16_t scpiReset(const char* parameter, Print& response) {
+  bool ok = submit(ADF4351_CMD_SET_FREQUENCY, 100000000) &&
+            submit(ADF4351_CMD_SET_POWER, 3) &&
+            submit(ADF4351_CMD_OUTPUT, 1);
+  return ok ? ADF4351_SCPI_NO_ERROR : ADF4351_SCPI_EXECUTION_ERROR;
+}
+
+// Wait until every command has been latched and the PLL has locked
+// (commands are executed by the time submit() returns, so only the lock
+// is left); without an LD pin isLocked() is always true
+int16_t waitForCompletion() {
+  if (adf4351.waitForLock(SCPI_LOCK_TIMEOUT_US) < 0 && !adf4351.isLocked()) {
+    return ADF4351_SCPI_DEVICE_ERROR;
+  }
+  return ADF4351_SCPI_NO_ERROR;
+}
+
+// *OPC?: 1 once complete
+int16_t scpiOpcQuery(const char* parameter, Print& response) {
+  int16_t error = waitForCompletion();
+  response.print(1);
+  return error;
+}
+
+// *WAI: wait for completion without a response
+int16_t scpiWait(const char* parameter, Print& response) {
+  return waitForCompletion();
+}
+
+// [SOURce]:FREQuency[:CW] <frequency>
+int16_t scpiFrequency(const char* parameter, Print& response) {
+  uint32_t frequency;
+  int16_t error = ADF4351Scpi::parseFrequency(parameter, frequency);
+  if (error != ADF4351_SCPI_NO_ERROR) {
+    return error;
+  }
+  if (frequency < 35000000) {
+    return ADF4351_SCPI_OUT_OF_RANGE;
+  }
+  return submit(ADF4351_CMD_RETUNE, frequency) ? ADF4351_SCPI_NO_ERROR : ADF4351_SCPI_EXECUTION_ERROR;
+}
+
+int16_t scpiFrequencyQuery(const char* parameter, Print& response) {
+  response.print(adf4351.getFrequency());
+  return ADF4351_SCPI_NO_ERROR;
+}
+
+// [SOURce]:POWer[:LEVel] <0-3>
+int16_t scpiPower(const char* parameter, Print& response) {
+  uint32_t level;
+  int16_t error = ADF4351Scpi::parseUint(parameter, level);
+  if (error != ADF4351_SCPI_NO_ERROR) {
+    return error;
   }
-  else if (command == "lownoise") {
-    // Set low noise mode
-    Serial.println("Setting low noise mode");
-    adf4351.setLowNoiseMode(true);
+  if (level > 3) {
+    return ADF4351_SCPI_OUT_OF_RANGE;
   }
-  else if (command == "lowspur") {
-    // Set low spur mode
-    Serial.println("Setting low spur mode");
-    adf4351.setLowNoiseMode(false);
+  return submit(ADF4351_CMD_SET_POWER, level) ? ADF4351_SCPI_NO_ERROR : ADF4351_SCPI_EXECUTION_ERROR;
+}
+
+int16_t scpiPowerQuery(const char* parameter, Print& response) {
+  response.print(adf4351.getPowerLevel());
+  return ADF4351_SCPI_NO_ERROR;
+}
+
+// OUTPut[:STATe] ON|OFF
+int16_t scpiOutput(const char* parameter, Print& response) {
+  bool enable;
+  int16_t error = ADF4351Scpi::parseBool(parameter, enable);
+  if (error != ADF4351_SCPI_NO_ERROR) {
+    return error;
   }
-  else if (command == "status") {
-    // Print current status
-    printStatus();
+  return submit(ADF4351_CMD_OUTPUT, enable) ? ADF4351_SCPI_NO_ERROR : ADF4351_SCPI_EXECUTION_ERROR;
+}
+
+int16_t scpiOutputQuery(const char* parameter, Print& response) {
+  response.print(adf4351.isOutputEnabled() ? 1 : 0);
+  return ADF4351_SCPI_NO_ERROR;
+}
+
+// SWEep:STARt / STOP / STEP <frequency>, applied at the next SWEep ON
+int16_t setSweepFrequency(const char* parameter, uint32_t& setting, uint32_t minimum) {
+  uint32_t frequency;
+  int16_t error = ADF4351Scpi::parseFrequency(parameter, frequency);
+  if (error != ADF4351_SCPI_NO_ERROR) {
+    return error;
   }
-  else if (command == "help") {
-    // Print help
-    printHelp();
+  if (frequency < minimum) {
+    return ADF4351_SCPI_OUT_OF_RANGE;
+  }
+  setting = frequency;
+  return ADF4351_SCPI_NO_ERROR;
+}
+
+int16_t scpiSweepStart(const char* parameter, Print& response) {
+  return setSweepFrequency(parameter, sweepStart, 35000000);
+}
+
+int16_t scpiSweepStartQuery(const char* parameter, Print& response) {
+  response.print(sweepStart);
+  return ADF4351_SCPI_NO_ERROR;
+}
+
+int16_t scpiSweepStop(const char* parameter, Print& response) {
+  return setSweepFrequency(parameter, sweepStop, 35000000);
+}
+
+int16_t scpiSweepStopQuery(const char* parameter, Print& response) {
+  response.print(sweepStop);
+  return ADF4351_SCPI_NO_ERROR;
+}
+
+int16_t scpiSweepStep(const char* parameter, Print& response) {
+  return setSweepFrequency(parameter, sweepStep, 1);
+}
+
+int16_t scpiSweepStepQuery(const char* parameter, Print& response) {
+  response.print(sweepStep);
+  return ADF4351_SCPI_NO_ERROR;
+}
+
+// SWEep:DWELl <time>, seconds unless suffixed
+int16_t scpiSweepDwell(const char* parameter, Print& response) {
+  uint32_t dwell;
+  int16_t error = ADF4351Scpi::parseTime(parameter, dwell);
+  if (error != ADF4351_SCPI_NO_ERROR) {
+    return error;
   }
-  else {
-    // Unknown command
-    Serial.println("Unknown command. Type 'help' for available commands.");
+  if (dwell < ADF4351_SWEEP_MIN_DWELL) {
+    return ADF4351_SCPI_OUT_OF_RANGE;
   }
+  sweepDwell = dwell;
+  return ADF4351_SCPI_NO_ERROR;
+}
+
+int16_t scpiSweepDwellQuery(const char* parameter, Print& response) {
+  // Seconds, as set without a suffix
+  response.print(sweepDwell / 1000000);
+  response.print('.');
+  char fraction[7];
+  snprintf(fraction, sizeof(fraction), "%06lu", (unsigned long)(sweepDwell % 1000000));
+  response.print(fraction);
+  return ADF4351_SCPI_NO_ERROR;
+}
+
+// SWEep[:STATe] ON|OFF: compile the settings and run them from the
+// engine's timer, repeating
+int16_t scpiSweepState(const char* parameter, Print& response) {
+  bool enable;
+  int16_t error = ADF4351Scpi::parseBool(parameter, enable);
+  if (error != ADF4351_SCPI_NO_ERROR) {
+    return error;
+  }
+  
+  stopSweep();
+  if (!enable) {
+    return ADF4351_SCPI_NO_ERROR;
+  }
+  if (sweepStop <= sweepStart || sweepStep > sweepStop - sweepStart) {
+    return ADF4351_SCPI_SETTINGS_CONFLICT;
+  }
+  
+  // The plan is compiled on the engine's core, with the sweep step as its
+  // resolution only; later FREQ settings keep their own
+  engine.setSweepPlan(&sweepPlan);
+  engine.setSweepRange(sweepStart, sweepStop, sweepStep);
+  if (!submitCommand(ADF4351_CMD_SWEEP_COMPILE, 0, 0) ||
+      !submitCommand(ADF4351_CMD_SWEEP_START, sweepDwell, 1)) {
+    return ADF4351_SCPI_EXECUTION_ERROR;
+  }
+  sweepOn = true;
+  return ADF4351_SCPI_NO_ERROR;
+}
+
+int16_t scpiSweepStateQuery(const char* parameter, Print& response) {
+  // The sweeper stops itself when steps fall a whole dwell behind
+  bool overrun = sweepOn && !engine.sweeper().isRunning();
+  if (overrun) {
+    sweepOn = false;
+  }
+  response.print(sweepOn ? 1 : 0);
+  return overrun ? ADF4351_SCPI_DEVICE_ERROR : ADF4351_SCPI_NO_ERROR;
+}
+
+// SYSTem:TEXT: back to the text commands
+int16_t scpiText(const char* parameter, Print& response) {
+  // The text and binary commands know nothing of the SCPI sweep
+  stopSweep();
+  scpiMode = false;
+  output.println("OK text");
+  return ADF4351_SCPI_NO_ERROR;
+}
+
+// SCPI command set (SYSTem:ERRor? and *CLS are built in)
+const ADF4351ScpiCommand SCPI_COMMANDS[] = {
+  {"*IDN?", scpiIdn},
+  {"*RST", scpiReset},
+  {"*OPC?", scpiOpcQuery},
+  {"*WAI", scpiWait},
+  {"[SOURce]:FREQuency[:CW]", scpiFrequency},
+  {"[SOURce]:FREQuency[:CW]?", scpiFrequencyQuery},
+  {"[SOURce]:POWer[:LEVel]", scpiPower},
+  {"[SOURce]:POWer[:LEVel]?", scpiPowerQuery},
+  {"OUTPut[:STATe]", scpiOutput},
+  {"OUTPut[:STATe]?", scpiOutputQuery},
+  {"SWEep:STARt", scpiSweepStart},
+  {"SWEep:STARt?", scpiSweepStartQuery},
+  {"SWEep:STOP", scpiSweepStop},
+  {"SWEep:STOP?", scpiSweepStopQuery},
+  {"SWEep:STEP", scpiSweepStep},
+  {"SWEep:STEP?", scpiSweepStepQuery},
+  {"SWEep:DWELl", scpiSweepDwell},
+  {"SWEep:DWELl?", scpiSweepDwellQuery},
+  {"SWEep[:STATe]", scpiSweepState},
+  {"SWEep[:STATe]?", scpiSweepStateQuery},
+  {"SYSTem:TEXT", scpiText}
+};
+ADF4351Scpi scpi(SCPI_COMMANDS, output);
+
+void processScpi(char* line) {
+  scpi.execute(line);
+}
+
+// A line longer than the input buffer is dropped and reported in the
+// error queue
+void processScpiOverflow() {
+  scpi.pushError(ADF4351_SCPI_SYNTAX_ERROR);
+}
+
+// Collect one byte of a binary frame
+void receiveFrameByte(uint8_t b) {
+  if (b != 0) {
+    if (frameLength < sizeof(frameBuffer)) {
+      frameBuffer[frameLength++] = b;
+    } else {
+      frameOverflow = true;
+    }
+    return;
+  }
+  
+  // Delimiter: handle the frame, or report one that didn't fit
+  if (frameOverflow) {
+    sendResponse(0, 0, ADF4351_STATUS_BAD_FRAME, 0, 0, 0);
+  } else if (frameLength > 0) {
+    processFrame(frameBuffer, frameLength);
+  }
+  frameLength = 0;
+  frameOverflow = false;
+}
+
+// Send one fixed-size response frame
+void sendResponse(uint8_t seq, uint8_t opcode, uint8_t status, uint8_t flags, uint32_t value, int32_t aux) {
+  uint8_t out[ADF4351_BINARY_RESPONSE + 4];
+  uint8_t length = ADF4351Binary::response(out, seq, opcode, status, flags, value, aux);
+  output.write(out, length);
+  output.endRecord();
+}
+
+// Decode, check and execute one binary request
+void processFrame(uint8_t* frame, uint16_t length) {
+  uint16_t size = ADF4351Binary::decode(frame, length);
+  if (size < ADF4351_BINARY_HEADER + ADF4351_BINARY_CRC ||
+      ADF4351Binary::crc16(frame, size - ADF4351_BINARY_CRC) != ADF4351Binary::get16(frame + size - ADF4351_BINARY_CRC)) {
+    sendResponse(0, 0, ADF4351_STATUS_BAD_FRAME, 0, 0, 0);
+    return;
+  }
+  
+  uint8_t seq = frame[0];
+  uint8_t opcode = frame[1];
+  const uint8_t* args = frame + ADF4351_BINARY_HEADER;
+  uint16_t argLength = size - ADF4351_BINARY_HEADER - ADF4351_BINARY_CRC;
+  uint8_t status = ADF4351_STATUS_OK;
+  uint8_t flags = 0;
+  uint32_t value = 0;
+  int32_t aux = 0;
+  
+  switch (opcode) {
+    case ADF4351_OP_SET_FREQUENCY:
+    case ADF4351_OP_RETUNE:
+      if (argLength != 4) {
+        status = ADF4351_STATUS_BAD_LENGTH;
+        break;
+      }
+      value = ADF4351Binary::get32(args);
+      if (value < 35000000 ||
+          !submit(opcode == ADF4351_OP_RETUNE ? ADF4351_CMD_RETUNE : ADF4351_CMD_SET_FREQUENCY, value)) {
+        status = ADF4351_STATUS_FAILED;
+      }
+      break;
+      
+    case ADF4351_OP_SET_POWER:
+    case ADF4351_OP_OUTPUT:
+      if (argLength != 1) {
+        status = ADF4351_STATUS_BAD_LENGTH;
+        break;
+      }
+      value = args[0];
+      if (opcode == ADF4351_OP_SET_POWER ? (value > 3 || !submit(ADF4351_CMD_SET_POWER, value))
+                                         : !submit(ADF4351_CMD_OUTPUT, value != 0)) {
+        status = ADF4351_STATUS_FAILED;
+      }
+      break;
+      
+    case ADF4351_OP_BATCH: {
+      // u16 dwell, then the frequencies
+      if (argLength < 2 || (argLength - 2) % 4 != 0) {
+        status = ADF4351_STATUS_BAD_LENGTH;
+        break;
+      }
+      uint16_t dwell = ADF4351Binary::get16(args);
+      uint16_t count = (argLength - 2) / 4;
+      for (uint16_t i = 0; i < count; i++) {
+        uint32_t frequency = ADF4351Binary::get32(args + 2 + 4 * i);
+        if (frequency < 35000000 || !submit(ADF4351_CMD_RETUNE, frequency)) {
+          status = ADF4351_STATUS_FAILED;
+          break;
+        }
+        value++;
+        if (i + 1 < count) {
+          delayMicroseconds(dwell);
+        }
+      }
+      break;
+    }
+      
+    case ADF4351_OP_QUERY:
+      value = adf4351.getFrequency();
+      aux = adf4351.getFrequencyError();
+      if (adf4351.isLocked()) flags |= ADF4351_BINARY_FLAG_LOCKED;
+      if (adf4351.isOutputEnabled()) flags |= ADF4351_BINARY_FLAG_OUTPUT;
+      if (adf4351.isIntegerN()) flags |= ADF4351_BINARY_FLAG_INTEGER_N;
+      break;
+      
+    case ADF4351_OP_TEXT_MODE:
+      binaryMode = false;
+      break;
+      
+    default:
+      status = ADF4351_STATUS_BAD_OPCODE;
+      break;
+  }
+  
+  sendResponse(seq, opcode, status, flags, value, aux);
+}
+
+// Parse "off", "on" or "auto" into a lock assist policy
+bool parseAssist(const char* value, ADF4351Assist& mode) {
+  if (strcmp(value, "off") == 0) {
+    mode = ADF4351_ASSIST_OFF;
+  } else if (strcmp(value, "on") == 0) {
+    mode = ADF4351_ASSIST_ON;
+  } else if (strcmp(value, "auto") == 0) {
+    mode = ADF4351_ASSIST_AUTO;
+  } else {
+    return false;
+  }
+  return true;
 }
 
 void printStatus() {
-  Serial.println("\nADF4351 Status:");
-  Serial.println("----------------");
+  output.println("\nADF4351 Status:");
+  output.println("----------------");
   
   // Print current frequency
-  Serial.print("Frequency: ");
-  Serial.print(adf4351.getFrequency());
-  Serial.println(" Hz");
+  output.print("Frequency: ");
+  output.print(adf4351.getFrequency());
+  output.println(" Hz");
+  
+  // Print the error left by the programmed FRAC/MOD
+  output.print("Frequency error: ");
+  output.print(adf4351.getFrequencyError());
+  output.println(" mHz");
+  
+  // Print the PFD frequency chosen by the planner
+  output.print("PFD: ");
+  output.print(adf4351.getPfdFrequency());
+  output.println(" Hz");
+  
+  // Print the PLL mode
+  output.print("PLL mode: ");
+  output.println(adf4351.isIntegerN() ? "Integer-N" : "Fractional-N");
+  
+  // Print the plan cache counters
+  output.print("Plan cache: ");
+  output.print(adf4351.getPlanCacheHits());
+  output.print(" hits, ");
+  output.print(adf4351.getPlanCacheMisses());
+  output.println(" misses");
+  
+  // Print the predicted VCO calibration time per retune
+  output.print("VCO calibration: ");
+  output.print(adf4351.getVcoCalibrationTime());
+  output.println(" us");
+  
+  // Print the parse time of the last command
+  output.print("Last command parse: ");
+  output.print(lastParseCycles);
+  output.print(" cycles (");
+  output.print((uint32_t)((uint64_t)lastParseCycles * 1000000000ULL / rp2040.f_cpu()));
+  output.println(" ns)");
   
   // Print lock status
-  Serial.print("PLL Lock: ");
-  Serial.println(adf4351.isLocked() ? "Locked" : "Unlocked");
+  output.print("PLL Lock: ");
+  output.println(adf4351.isLocked() ? "Locked" : "Unlocked");
+  
+  // Print lines lost to a full output queue
+  output.print("Output dropped: ");
+  output.print(output.getDropped());
+  output.println(" lines");
+  
+  output.println();
+}
+
+void printLockStats() {
+  output.println("\nLock Time Statistics:");
+  output.println("---------------------");
+  
+  bool any = false;
+  for (uint8_t band = 0; band < ADF4351_BANDS; band++) {
+    ADF4351LockStats stats = adf4351.getLockStats(band);
+    if (stats.count == 0 && stats.missed == 0) {
+      continue;
+    }
+    any = true;
+    
+    // Band header: RF divider and its lower frequency edge
+    output.print("RF divider /");
+    output.print(1 << band);
+    output.print(" (from ");
+    output.print(2200 >> band);
+    output.println(" MHz):");
+    
+    output.print("  Locks: ");
+    output.print(stats.count);
+    output.print(", missed: ");
+    output.println(stats.missed);
+    
+    if (stats.count > 0) {
+      output.print("  Min/mean/max: ");
+      output.print(stats.minTime);
+      output.print(" / ");
+      output.print((uint32_t)(stats.totalTime / stats.count));
+      output.print(" / ");
+      output.print(stats.maxTime);
+      output.println(" us");
+    }
+    
+    // Histogram, non-empty buckets only
+    uint32_t lower = 0;
+    for (uint8_t i = 0; i < ADF4351_LOCK_BUCKETS; i++) {
+      uint32_t upper = ADF4351Base::lockBucketLimit(i);
+      if (stats.buckets[i] > 0) {
+        output.print("  ");
+        output.print(lower);
+        if (upper > 0) {
+          output.print("-");
+          output.print(upper - 1);
+        } else {
+          output.print("+");
+        }
+        output.print(" us: ");
+        output.println(stats.buckets[i]);
+      }
+      lower = upper;
+    }
+  }
   
-  Serial.println();
+  if (!any) {
+    output.println("No locks measured (is the LD pin connected?)");
+  }
+  output.println();
 }
 
 void printHelp() {
-  Serial.println("\nAvailable Commands:");
-  Serial.println("------------------");
-  Serial.println("freq <Hz>    - Set frequency in Hz (35MHz to 4.4GHz)");
-  Serial.println("power <0-3>  - Set output power (0:-4dBm, 1:-1dBm, 2:+2dBm, 3:+5dBm)");
-  Serial.println("on           - Enable RF output");
-  Serial.println("off          - Disable RF output");
-  Serial.println("phase <0-4095> - Set phase value");
-  Serial.println("lownoise     - Set low noise mode");
-  Serial.println("lowspur      - Set low spur mode");
-  Serial.println("status       - Display current status");
-  Serial.println("help         - Display this help message");
-  Serial.println("\nExample: freq 145000000");
-  Serial.println();
+  output.println("\nAvailable Commands:");
+  output.println("------------------");
+  output.println("freq <Hz>    - Set frequency in Hz (35MHz to 4.4GHz)");
+  output.println("power <0-3>  - Set output power (0:-4dBm, 1:-1dBm, 2:+2dBm, 3:+5dBm)");
+  output.println("on           - Enable RF output");
+  output.println("off          - Disable RF output");
+  output.println("phase <0-4095> - Set phase value");
+  output.println("lownoise     - Set low noise mode");
+  output.println("lowspur      - Set low spur mode");
+  output.println("fastlock <off|on|auto> - Fast lock (auto: band changes and large jumps)");
+  output.println("csr <off|on|auto>      - Cycle slip reduction");
+  output.println("status       - Display current status");
+  output.println("stats        - Display lock time statistics per RF divider band");
+  output.println("stats clear  - Clear lock time statistics");
+  output.println("binary       - Switch to the binary framed protocol (see ADF4351_Binary.h)");
+  output.println("scpi         - Switch to SCPI commands (SYSTem:TEXT switches back)");
+  output.println("help         - Display this help message");
+  output.println("\nExample: freq 145000000");
+  output.println();
 }
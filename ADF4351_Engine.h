@@ -0,0 +1,245 @@
+/*
+ * ADF4351_Engine.h - Command queue front end for running the ADF4351 on
+ * its own core
+ *
+ * Core 0 (serial parsing, printing, displays) posts typed commands into a
+ * lock-free single-producer/single-consumer ring; the engine drains it on
+ * core 1 and does all register writes there, so RF timing no longer
+ * depends on USB CDC or display load:
+ *
+ *   ADF4351 adf4351(LE, CLK, DATA, CE);
+ *   ADF4351Engine<ADF4351GpioBus> engine(adf4351);
+ *
+ *   void loop()   { ... engine.post(ADF4351_CMD_RETUNE, frequency); ... }
+ *   void setup1() { engine.begin(); }
+ *   void loop1()  { engine.poll(); }
+ *
+ * Only core 1 may call the driver's setters once commands are posted;
+ * core 0 keeps to the getters. execute() runs a command directly, for
+ * sketches that stay on one core. A tuning command stops a running sweep.
+ *
+ * Created: October 2026
+ */
+
+#ifndef ADF4351_ENGINE_H
+#define ADF4351_ENGINE_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "ADF4351.h"
+#include "ADF4351_Sweeper.h"
+
+// Default number of commands the queue holds (power of two)
+#ifndef ADF4351_ENGINE_QUEUE_SIZE
+#define ADF4351_ENGINE_QUEUE_SIZE 32
+#endif
+
+// Timers the engine's alarm pool holds
+#define ADF4351_ENGINE_TIMERS 4
+
+// Command types
+enum ADF4351CommandType {
+  ADF4351_CMD_SET_FREQUENCY,  // value = frequency (Hz)
+  ADF4351_CMD_RETUNE,         // value = frequency (Hz), R0 only if possible
+  ADF4351_CMD_SET_POWER,      // value = power level (0-3)
+  ADF4351_CMD_OUTPUT,         // value = 1 on, 0 off (keying)
+  ADF4351_CMD_SET_PHASE,      // value = phase (0-4095)
+  ADF4351_CMD_LOW_NOISE,      // value = 1 low noise, 0 low spur
+  ADF4351_CMD_FAST_LOCK,      // value = ADF4351Assist
+  ADF4351_CMD_CYCLE_SLIP,     // value = ADF4351Assist
+  ADF4351_CMD_SWEEP_COMPILE,  // Solve the setSweepRange() range into the plan
+  ADF4351_CMD_SWEEP_START,    // value = dwell (us), arg = 1 to repeat
+  ADF4351_CMD_SWEEP_STOP
+};
+
+// One queued command
+struct ADF4351Command {
+  uint8_t type;    // ADF4351CommandType
+  uint32_t value;  // Main argument
+  uint32_t arg;    // Second argument
+};
+
+// Lock-free single-producer/single-consumer ring of commands
+// The producer only writes _head and the consumer only writes _tail; the
+// release/acquire pair orders the slot contents against the index
+template <uint16_t SIZE>
+class ADF4351CommandQueue {
+  static_assert(SIZE >= 2 && (SIZE & (SIZE - 1)) == 0, "ADF4351CommandQueue size must be a power of two");
+
+  public:
+    ADF4351CommandQueue() : _head(0), _tail(0) {}
+
+    // Producer: add a command; false if the queue is full
+    bool push(const ADF4351Command& command) {
+      uint32_t head = _head.load(std::memory_order_relaxed);
+      if (head - _tail.load(std::memory_order_acquire) >= SIZE) {
+        return false;
+      }
+      _slots[head & (SIZE - 1)] = command;
+      _head.store(head + 1, std::memory_order_release);
+      return true;
+    }
+
+    // Consumer: take the oldest command; false if the queue is empty
+    bool pop(ADF4351Command& command) {
+      uint32_t tail = _tail.load(std::memory_order_relaxed);
+      if (tail == _head.load(std::memory_order_acquire)) {
+        return false;
+      }
+      command = _slots[tail & (SIZE - 1)];
+      _tail.store(tail + 1, std::memory_order_release);
+      return true;
+    }
+
+    // Number of commands waiting
+    uint32_t count() {
+      return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+    }
+
+  private:
+    ADF4351Command _slots[SIZE];
+    std::atomic<uint32_t> _head;  // Next slot to write (producer)
+    std::atomic<uint32_t> _tail;  // Next slot to read (consumer)
+};
+
+template <class Bus, uint16_t QUEUE = ADF4351_ENGINE_QUEUE_SIZE>
+class ADF4351Engine {
+  public:
+    // Constructor
+    explicit ADF4351Engine(ADF4351T<Bus>& adf)
+      : _adf(adf), _sweeper(adf), _plan(NULL), _sweepStart(0), _sweepStop(0), _sweepStep(0),
+        _posted(0), _completed(0), _failed(0), _dropped(0) {}
+
+    // Producer side (core 0) ------------------------------------------------
+
+    // Queue a command; returns its sequence number (1, 2, ...), or 0 if
+    // the queue was full and the command was dropped
+    uint32_t post(uint8_t type, uint32_t value = 0, uint32_t arg = 0) {
+      ADF4351Command command = {type, value, arg};
+      if (!_queue.push(command)) {
+        _dropped++;
+        return 0;
+      }
+      return ++_posted;
+    }
+
+    // Wait up to timeout_us until command seq has been executed
+    bool waitFor(uint32_t seq, uint32_t timeout_us) {
+      uint32_t start = micros();
+      while ((int32_t)(_completed.load(std::memory_order_acquire) - seq) < 0) {
+        if (micros() - start >= timeout_us) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    // Plan filled by ADF4351_CMD_SWEEP_COMPILE and run by
+    // ADF4351_CMD_SWEEP_START (set before posting them)
+    void setSweepPlan(ADF4351SweepPlan* plan) { _plan = plan; }
+
+    // Range ADF4351_CMD_SWEEP_COMPILE solves, with step as the plan's
+    // channel resolution (set before posting it)
+    void setSweepRange(uint32_t start, uint32_t stop, uint32_t step) {
+      _sweepStart = start;
+      _sweepStop = stop;
+      _sweepStep = step;
+    }
+
+    // Commands executed / rejected by the driver / dropped on a full queue
+    uint32_t getCompleted() { return _completed.load(std::memory_order_acquire); }
+    uint32_t getFailed() { return _failed.load(std::memory_order_relaxed); }
+    uint32_t getDropped() { return _dropped; }
+
+    // Consumer side (core 1) ------------------------------------------------
+
+    // Create the sweep timer's alarm pool on the calling core, so sweep
+    // steps fire on the engine's core rather than on core 0; call from
+    // setup1()
+    void begin() {
+      _sweeper.setAlarmPool(alarm_pool_create_with_unused_hardware_alarm(ADF4351_ENGINE_TIMERS));
+    }
+
+    // Execute every queued command; returns how many ran
+    uint16_t poll() {
+      ADF4351Command command;
+      uint16_t count = 0;
+      while (_queue.pop(command)) {
+        if (!execute(command)) {
+          _failed.fetch_add(1, std::memory_order_relaxed);
+        }
+        _completed.fetch_add(1, std::memory_order_release);
+        count++;
+      }
+      return count;
+    }
+
+    // Execute one command on the calling core; any command other than a
+    // sweep command ends a running sweep first, so its writes never
+    // interleave with the sweep timer's
+    bool execute(const ADF4351Command& command) {
+      if (command.type != ADF4351_CMD_SWEEP_START && command.type != ADF4351_CMD_SWEEP_STOP && _sweeper.isRunning()) {
+        _sweeper.stop();
+      }
+
+      switch (command.type) {
+        case ADF4351_CMD_SET_FREQUENCY:
+          return _adf.setFrequency(command.value);
+        case ADF4351_CMD_RETUNE:
+          return _adf.retune(command.value);
+        case ADF4351_CMD_SET_POWER:
+          if (command.value > 3) return false;
+          _adf.setPowerLevel((uint8_t)command.value);
+          return true;
+        case ADF4351_CMD_OUTPUT:
+          _adf.enableOutput(command.value != 0);
+          return true;
+        case ADF4351_CMD_SET_PHASE:
+          if (command.value > 4095) return false;
+          _adf.setPhase((uint16_t)command.value);
+          return true;
+        case ADF4351_CMD_LOW_NOISE:
+          _adf.setLowNoiseMode(command.value != 0);
+          return true;
+        case ADF4351_CMD_FAST_LOCK:
+          if (command.value > ADF4351_ASSIST_AUTO) return false;
+          _adf.setFastLock((ADF4351Assist)command.value);
+          return true;
+        case ADF4351_CMD_CYCLE_SLIP:
+          if (command.value > ADF4351_ASSIST_AUTO) return false;
+          _adf.setCycleSlipReduction((ADF4351Assist)command.value);
+          return true;
+        case ADF4351_CMD_SWEEP_COMPILE:
+          // The setters run here, so compiling follows the one core rule
+          if (_plan == NULL) return false;
+          return _adf.compileSweep(*_plan, _sweepStart, _sweepStop, _sweepStep, _sweepStep);
+        case ADF4351_CMD_SWEEP_START:
+          // Steps fire on the core of the pool set up by begin()
+          if (_plan == NULL) return false;
+          return _sweeper.start(*_plan, command.value, command.arg != 0);
+        case ADF4351_CMD_SWEEP_STOP:
+          _sweeper.stop();
+          return true;
+        default:
+          return false;
+      }
+    }
+
+    // Sweep engine run by ADF4351_CMD_SWEEP_START
+    ADF4351Sweeper<Bus>& sweeper() { return _sweeper; }
+
+  private:
+    ADF4351T<Bus>& _adf;
+    ADF4351Sweeper<Bus> _sweeper;
+    ADF4351SweepPlan* _plan;
+    uint32_t _sweepStart;                // setSweepRange(), producer only
+    uint32_t _sweepStop;
+    uint32_t _sweepStep;
+    ADF4351CommandQueue<QUEUE> _queue;
+    uint32_t _posted;                    // Producer only
+    std::atomic<uint32_t> _completed;    // Consumer only
+    std::atomic<uint32_t> _failed;       // Consumer only
+    uint32_t _dropped;                   // Producer only
+};
+
+#endif
@@ -0,0 +1,118 @@
+/*
+ * ADF4351_Output.h - Non-blocking output queue for the ADF4351 sketches
+ *
+ * Serial.print() blocks while the USB CDC buffer is full, i.e. whenever
+ * the host is slow to read the port, and with it whatever retune or sweep
+ * step comes next. ADF4351Output is a Print that formats into a fixed
+ * ring instead; drain() hands the queued bytes to the port only as fast
+ * as it accepts them without blocking:
+ *
+ *   ADF4351Output<2048> output(Serial);
+ *
+ *   output.print("Frequency: ");
+ *   output.println(frequency);
+ *   ...
+ *   void loop() { output.drain(); ... }
+ *
+ * Output is queued in records, normally lines: a record is only sent once
+ * it is complete, and one that does not fit is dropped whole and counted,
+ * so the port never sees half a line. endRecord() closes a record that
+ * does not end in a newline, such as a binary frame.
+ *
+ * Not interrupt or multi-core safe; print and drain from one core.
+ *
+ * Created: October 2026
+ */
+
+#ifndef ADF4351_OUTPUT_H
+#define ADF4351_OUTPUT_H
+
+#include <Arduino.h>
+
+template <uint16_t SIZE>
+class ADF4351Output : public Print {
+  static_assert(SIZE >= 2 && (SIZE & (SIZE - 1)) == 0, "ADF4351Output size must be a power of two");
+
+  public:
+    // Constructor
+    explicit ADF4351Output(Print& port)
+      : _port(port), _head(0), _record(0), _tail(0), _dropping(false), _dropped(0) {}
+
+    // Queue one byte; a newline completes the record
+    size_t write(uint8_t c) override {
+      if (!_dropping) {
+        if (_head - _tail < SIZE) {
+          _buffer[_head++ & (SIZE - 1)] = c;
+        } else {
+          // Full: discard the partial record up to its end
+          _head = _record;
+          _dropping = true;
+          _dropped++;
+        }
+      }
+      if (c == '\n') {
+        endRecord();
+      }
+      return 1;
+    }
+
+    size_t write(const uint8_t* buffer, size_t size) override {
+      for (size_t i = 0; i < size; i++) {
+        write(buffer[i]);
+      }
+      return size;
+    }
+
+    using Print::write;
+
+    // Complete the current record, making it ready to send
+    void endRecord() {
+      if (!_dropping) {
+        _record = _head;
+      }
+      _dropping = false;
+    }
+
+    // Send as much of the completed records as the port takes without
+    // blocking; returns the number of bytes sent
+    uint16_t drain() {
+      uint16_t sent = 0;
+      while (_tail != _record) {
+        int space = _port.availableForWrite();
+        if (space <= 0) {
+          break;
+        }
+
+        // Contiguous run up to the end of the ring or of the data
+        uint32_t offset = _tail & (SIZE - 1);
+        uint32_t length = _record - _tail;
+        if (length > SIZE - offset) length = SIZE - offset;
+        if (length > (uint32_t)space) length = space;
+
+        length = _port.write(_buffer + offset, length);
+        if (length == 0) {
+          break;
+        }
+        _tail += length;
+        sent += length;
+      }
+      return sent;
+    }
+
+    // Bytes queued, including an incomplete record
+    uint16_t getPending() { return _head - _tail; }
+
+    // Records dropped because the queue was full
+    uint32_t getDropped() { return _dropped; }
+
+  private:
+    Print& _port;
+    uint8_t _buffer[SIZE];
+    uint32_t _head;      // Next byte to write
+    uint32_t _record;    // End of the last completed record
+    uint32_t _tail;      // Next byte to send
+    bool _dropping;      // Discarding the rest of an oversized record
+    uint32_t _dropped;
+};
+
+#endif
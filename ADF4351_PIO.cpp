@@ -0,0 +1,120 @@
+/*
+ * ADF4351_PIO.cpp - PIO serial engine for the ADF4351 library
+ *
+ * The program is assembled at run time with the pico-sdk encoders, so no
+ * pioasm step is needed in the Arduino build:
+ *
+ *   .side_set 1                       ; side-set pin = CLK
+ *   0: pull block       side 0        ; idle with LE high, CLK low
+ *   1: set pins, 0      side 0        ; LE low (set pin = LE)
+ *   2: set x, 31        side 0
+ *   3: out pins, 1      side 0 [1]    ; DATA changes while CLK is low
+ *   4: jmp x-- 3        side 1 [1]    ; CLK high, ADF4351 samples DATA
+ *   5: set pins, 1      side 0 [1]    ; LE high latches the word
+ *
+ * One serial clock period is 4 state machine cycles (2 low, 2 high).
+ * The divider is rounded up to an integer so every cycle has the same
+ * length; a fractional divider would shorten individual cycles. With a
+ * cycle time of tc = 1 / (4 * fCLK) the datasheet timing becomes:
+ *
+ *   t1 LE setup to first CLK    >= 10 ns   4 tc
+ *   t2 DATA setup to CLK        >= 10 ns   2 tc
+ *   t3 DATA hold after CLK      >= 10 ns   2 tc
+ *   t4 CLK high                 >= 25 ns   2 tc
+ *   t5 CLK low                  >= 25 ns   2 tc
+ *   t6 last CLK to LE high      >= 10 ns   2 tc
+ *   t7 LE high between words    >= 20 ns   3 tc minimum
+ *
+ * t4/t5 are the limiting terms, so tc >= 12.5 ns and fCLK <= 20 MHz.
+ * tests/test_pio.cpp runs the assembled program cycle by cycle at the
+ * dividers clockDivider() picks and checks t1-t7 against these minimums.
+ *
+ * Created: October 2026
+ */
+
+#include "ADF4351_PIO.h"
+#include <hardware/clocks.h>
+
+// Constructor
+ADF4351Pio::ADF4351Pio() {
+  _pio = NULL;
+  _sm = 0;
+  _offset = 0;
+  _clockHz = 0;
+}
+
+// Load the program into a free PIO block and start a state machine
+bool ADF4351Pio::begin(uint8_t le_pin, uint8_t clk_pin, uint8_t data_pin, uint32_t clockHz) {
+  uint16_t instructions[ADF4351_PIO_PROGRAM_LENGTH];
+  assemble(instructions);
+
+  pio_program_t program = {};
+  program.instructions = instructions;
+  program.length = ADF4351_PIO_PROGRAM_LENGTH;
+  program.origin = -1;
+
+  // Find a PIO block with room for the program and a free state machine
+  PIO candidates[] = {pio0, pio1};
+  _pio = NULL;
+  for (uint8_t i = 0; i < sizeof(candidates) / sizeof(candidates[0]); i++) {
+    if (!pio_can_add_program(candidates[i], &program)) {
+      continue;
+    }
+    int sm = pio_claim_unused_sm(candidates[i], false);
+    if (sm < 0) {
+      continue;
+    }
+    _pio = candidates[i];
+    _sm = (uint)sm;
+    break;
+  }
+  if (_pio == NULL) {
+    return false;
+  }
+  _offset = pio_add_program(_pio, &program);
+
+  // Integer divider so that 4 cycles never run faster than one CLK period
+  uint32_t sysHz = clock_get_hz(clk_sys);
+  uint32_t div = clockDivider(sysHz, clockHz);
+  _clockHz = sysHz / (4 * div);
+
+  pio_sm_config config = pio_get_default_sm_config();
+  sm_config_set_wrap(&config, _offset, _offset + ADF4351_PIO_PROGRAM_LENGTH - 1);
+  sm_config_set_out_pins(&config, data_pin, 1);
+  sm_config_set_set_pins(&config, le_pin, 1);
+  sm_config_set_sideset_pins(&config, clk_pin);
+  sm_config_set_sideset(&config, 1, false, false);
+  // Shift left (MSB first), manual pull of one 32-bit word per transfer
+  sm_config_set_out_shift(&config, false, false, 32);
+  // Join the FIFOs so a full 6-register update fits without blocking
+  sm_config_set_fifo_join(&config, PIO_FIFO_JOIN_TX);
+  sm_config_set_clkdiv_int_frac(&config, (uint16_t)div, 0);
+
+  // Hand the pins to the PIO with LE high, CLK low and DATA low
+  uint32_t pinMask = (1u << le_pin) | (1u << clk_pin) | (1u << data_pin);
+  pio_gpio_init(_pio, le_pin);
+  pio_gpio_init(_pio, clk_pin);
+  pio_gpio_init(_pio, data_pin);
+  pio_sm_set_pins_with_mask(_pio, _sm, 1u << le_pin, pinMask);
+  pio_sm_set_pindirs_with_mask(_pio, _sm, pinMask, pinMask);
+
+  pio_sm_init(_pio, _sm, _offset, &config);
+  pio_sm_set_enabled(_pio, _sm, true);
+
+  return true;
+}
+
+// Wait until every queued word has been shifted out and latched
+void ADF4351Pio::flush() {
+  // The state machine is idle once the FIFO is empty and it is stalled on
+  // the pull at the start of the program (LE already high)
+  while (!pio_sm_is_tx_fifo_empty(_pio, _sm)) {
+  }
+  while (pio_sm_get_pc(_pio, _sm) != _offset) {
+  }
+}
+
+// Actual serial clock rate after rounding the divider
+uint32_t ADF4351Pio::getClock() {
+  return _clockHz;
+}
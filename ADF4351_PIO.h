@@ -0,0 +1,73 @@
+/*
+ * ADF4351_PIO.h - PIO serial engine for the ADF4351 library
+ *
+ * Shifts complete 32-bit register words into the ADF4351 using one
+ * RP2350 PIO state machine. The state machine drives CLK, DATA and LE
+ * on its own, so the CPU only has to push words into the TX FIFO.
+ *
+ * Created: October 2026
+ */
+
+#ifndef ADF4351_PIO_H
+#define ADF4351_PIO_H
+
+#include <Arduino.h>
+#include <hardware/pio.h>
+
+// Default serial clock rate for the PIO engine (Hz)
+// The ADF4351 accepts up to 20 MHz (t4 = t5 = 25 ns minimum)
+#ifndef ADF4351_PIO_CLOCK
+#define ADF4351_PIO_CLOCK 20000000
+#endif
+
+// Number of instructions in the serial program
+#define ADF4351_PIO_PROGRAM_LENGTH 6
+
+class ADF4351Pio {
+  public:
+    // Constructor
+    ADF4351Pio();
+
+    // Load the program into a free PIO block and start a state machine
+    // Returns false if no PIO instruction memory or state machine is free
+    bool begin(uint8_t le_pin, uint8_t clk_pin, uint8_t data_pin, uint32_t clockHz = ADF4351_PIO_CLOCK);
+
+    // Queue one register word (only blocks if the 8-word FIFO is full)
+    inline void write(uint32_t value) {
+      pio_sm_put_blocking(_pio, _sm, value);
+    }
+
+    // Wait until every queued word has been shifted out and latched
+    void flush();
+
+    // Actual serial clock rate after rounding the divider (Hz)
+    uint32_t getClock();
+
+    // Assemble the serial program (listed in ADF4351_PIO.cpp); CLK is
+    // the one side-set pin, LE the set pin and DATA the out pin
+    static void assemble(uint16_t (&instructions)[ADF4351_PIO_PROGRAM_LENGTH]) {
+      instructions[0] = pio_encode_pull(false, true) | pio_encode_sideset(1, 0);
+      instructions[1] = pio_encode_set(pio_pins, 0) | pio_encode_sideset(1, 0);
+      instructions[2] = pio_encode_set(pio_x, 31) | pio_encode_sideset(1, 0);
+      instructions[3] = pio_encode_out(pio_pins, 1) | pio_encode_sideset(1, 0) | pio_encode_delay(1);
+      instructions[4] = pio_encode_jmp_x_dec(3) | pio_encode_sideset(1, 1) | pio_encode_delay(1);
+      instructions[5] = pio_encode_set(pio_pins, 1) | pio_encode_sideset(1, 0) | pio_encode_delay(1);
+    }
+
+    // Integer state machine clock divider so that 4 cycles never run
+    // faster than one period of clockHz
+    static uint32_t clockDivider(uint32_t sysHz, uint32_t clockHz) {
+      uint32_t div = (sysHz + 4 * clockHz - 1) / (4 * clockHz);
+      if (div < 1) div = 1;
+      if (div > 65535) div = 65535;
+      return div;
+    }
+
+  private:
+    PIO _pio;           // PIO block in use
+    uint _sm;           // State machine index
+    uint _offset;       // Program load offset
+    uint32_t _clockHz;  // Actual serial clock rate
+};
+
+#endif
@@ -0,0 +1,506 @@
+/*
+ * ADF4351_Scpi.h - SCPI command front end for the ADF4351 sketches
+ *
+ * Lets instrument drivers and sequencers written for SCPI signal
+ * generators talk to a sketch directly. The sketch lists its command
+ * headers in SCPI notation, long form with the short form in upper case
+ * and optional nodes in brackets, and a handler for each:
+ *
+ *   int16_t scpiFrequency(const char* parameter, Print& response);
+ *   int16_t scpiFrequencyQuery(const char* parameter, Print& response);
+ *
+ *   const ADF4351ScpiCommand SCPI_COMMANDS[] = {
+ *     {"[SOURce]:FREQuency[:CW]", scpiFrequency},
+ *     {"[SOURce]:FREQuency[:CW]?", scpiFrequencyQuery},
+ *   };
+ *   ADF4351Scpi scpi(SCPI_COMMANDS, Serial);
+ *   ...
+ *   scpi.execute(line);
+ *
+ * so "FREQ 145MHZ", "freq:cw 145.5 MHz" and "SOUR:FREQ 1.2E9" all reach
+ * scpiFrequency() with the text after the header. Handlers parse it with
+ * parseFrequency(), parseTime(), parseBool() or parseUint(), print query
+ * results without a line ending and return 0 or a SCPI error code.
+ *
+ * One line may hold several commands separated by ';'. A header that does
+ * not start with ':' or '*' continues from the path of the previous one,
+ * so "SWE:STAR 100MHZ;STOP 200MHZ" sets both ends of the sweep. The
+ * responses of all queries in a line go out together, separated by ';'.
+ *
+ * Errors are queued (oldest first) for SYSTem:ERRor[:NEXT]?, which is
+ * built in together with *CLS.
+ *
+ * Created: October 2026
+ */
+
+#ifndef ADF4351_SCPI_H
+#define ADF4351_SCPI_H
+
+#include <Arduino.h>
+
+// SCPI error codes used by the parser and the parameter helpers
+#define ADF4351_SCPI_NO_ERROR 0
+#define ADF4351_SCPI_SYNTAX_ERROR -102
+#define ADF4351_SCPI_DATA_TYPE_ERROR -104
+#define ADF4351_SCPI_PARAMETER_NOT_ALLOWED -108
+#define ADF4351_SCPI_MISSING_PARAMETER -109
+#define ADF4351_SCPI_UNDEFINED_HEADER -113
+#define ADF4351_SCPI_INVALID_SUFFIX -131
+#define ADF4351_SCPI_EXECUTION_ERROR -200
+#define ADF4351_SCPI_SETTINGS_CONFLICT -221
+#define ADF4351_SCPI_OUT_OF_RANGE -222
+#define ADF4351_SCPI_ILLEGAL_VALUE -224
+#define ADF4351_SCPI_DEVICE_ERROR -300
+#define ADF4351_SCPI_QUEUE_OVERFLOW -350
+
+// Depth of the error queue
+#ifndef ADF4351_SCPI_ERROR_QUEUE
+#define ADF4351_SCPI_ERROR_QUEUE 8
+#endif
+
+// Most nodes in a header, and longest header with the path prepended
+#define ADF4351_SCPI_MAX_NODES 6
+#define ADF4351_SCPI_MAX_HEADER 48
+
+// Handler for one header: parameter is the text after it ("" if none);
+// query results are printed to response. Returns 0 or an error code
+typedef int16_t (*ADF4351ScpiHandler)(const char* parameter, Print& response);
+
+// One command header ("SWEep:STARt", "[SOURce]:FREQuency[:CW]?", "*IDN?")
+struct ADF4351ScpiCommand {
+  const char* header;
+  ADF4351ScpiHandler handler;
+};
+
+class ADF4351Scpi {
+  public:
+    // Constructor
+    template <size_t N>
+    ADF4351Scpi(const ADF4351ScpiCommand (&commands)[N], Print& out)
+      : _commands(commands), _count(N), _out(out), _errorCount(0) {}
+
+    // Execute one line of ';' separated commands (modified in place)
+    void execute(char* line) {
+      char path[ADF4351_SCPI_MAX_HEADER] = "";
+      bool responded = false;
+
+      char* next = line;
+      while (next != NULL) {
+        char* command = next;
+        next = strchr(command, ';');
+        if (next != NULL) {
+          *next++ = '\0';
+        }
+
+        // Header up to the first space, parameter after it
+        command = trim(command);
+        if (*command == '\0') {
+          continue;
+        }
+        char* parameter = command;
+        while (*parameter != '\0' && *parameter != ' ' && *parameter != '\t') {
+          parameter++;
+        }
+        if (*parameter != '\0') {
+          *parameter++ = '\0';
+        }
+        parameter = trim(parameter);
+
+        int16_t error = dispatch(command, parameter, path, responded);
+        if (error != ADF4351_SCPI_NO_ERROR) {
+          pushError(error);
+        }
+      }
+
+      if (responded) {
+        _out.println();
+      }
+    }
+
+    // Queue an error; the last entry becomes a queue overflow when full
+    void pushError(int16_t code) {
+      if (_errorCount < ADF4351_SCPI_ERROR_QUEUE) {
+        _errors[_errorCount++] = code;
+      } else {
+        _errors[ADF4351_SCPI_ERROR_QUEUE - 1] = ADF4351_SCPI_QUEUE_OVERFLOW;
+      }
+    }
+
+    // Take the oldest queued error, 0 if there is none
+    int16_t popError() {
+      if (_errorCount == 0) {
+        return ADF4351_SCPI_NO_ERROR;
+      }
+      int16_t code = _errors[0];
+      _errorCount--;
+      memmove(_errors, _errors + 1, _errorCount * sizeof(_errors[0]));
+      return code;
+    }
+
+    // Clear the error queue
+    void clearErrors() { _errorCount = 0; }
+
+    // Description of an error code
+    static const char* errorMessage(int16_t code) {
+      switch (code) {
+        case ADF4351_SCPI_NO_ERROR: return "No error";
+        case ADF4351_SCPI_SYNTAX_ERROR: return "Syntax error";
+        case ADF4351_SCPI_DATA_TYPE_ERROR: return "Data type error";
+        case ADF4351_SCPI_PARAMETER_NOT_ALLOWED: return "Parameter not allowed";
+        case ADF4351_SCPI_MISSING_PARAMETER: return "Missing parameter";
+        case ADF4351_SCPI_UNDEFINED_HEADER: return "Undefined header";
+        case ADF4351_SCPI_INVALID_SUFFIX: return "Invalid suffix";
+        case ADF4351_SCPI_EXECUTION_ERROR: return "Execution error";
+        case ADF4351_SCPI_SETTINGS_CONFLICT: return "Settings conflict";
+        case ADF4351_SCPI_OUT_OF_RANGE: return "Data out of range";
+        case ADF4351_SCPI_ILLEGAL_VALUE: return "Illegal parameter value";
+        case ADF4351_SCPI_DEVICE_ERROR: return "Device-specific error";
+        case ADF4351_SCPI_QUEUE_OVERFLOW: return "Queue overflow";
+        default: return "Error";
+      }
+    }
+
+    // Parameter helpers -----------------------------------------------------
+
+    // Parse a frequency in Hz: "145000000", "145MHZ", "145.5 MHz", "1.2E9",
+    // suffixes HZ, KHZ, MHZ and GHZ
+    static int16_t parseFrequency(const char* text, uint32_t& hz) {
+      static const Unit units[] = {{"HZ", 0}, {"KHZ", 3}, {"MHZ", 6}, {"GHZ", 9}};
+      return parseNumber(text, units, sizeof(units) / sizeof(units[0]), 0, hz);
+    }
+
+    // Parse a time in microseconds: "0.001", "1MS", "50 us", "5E-5",
+    // suffixes S (the default), MS, US and NS
+    static int16_t parseTime(const char* text, uint32_t& us) {
+      static const Unit units[] = {{"S", 6}, {"MS", 3}, {"US", 0}, {"NS", -3}};
+      return parseNumber(text, units, sizeof(units) / sizeof(units[0]), 6, us);
+    }
+
+    // Parse a plain unsigned number
+    static int16_t parseUint(const char* text, uint32_t& value) {
+      return parseNumber(text, NULL, 0, 0, value);
+    }
+
+    // Parse ON, OFF, 1 or 0
+    static int16_t parseBool(const char* text, bool& value) {
+      if (*text == '\0') {
+        return ADF4351_SCPI_MISSING_PARAMETER;
+      }
+      if (equalsIgnoreCase(text, "ON") || strcmp(text, "1") == 0) {
+        value = true;
+      } else if (equalsIgnoreCase(text, "OFF") || strcmp(text, "0") == 0) {
+        value = false;
+      } else {
+        return ADF4351_SCPI_ILLEGAL_VALUE;
+      }
+      return ADF4351_SCPI_NO_ERROR;
+    }
+
+    // Match a header typed by the user against a command header pattern
+    static bool matchHeader(const char* pattern, const char* header) {
+      Node patternNodes[ADF4351_SCPI_MAX_NODES];
+      Node headerNodes[ADF4351_SCPI_MAX_NODES];
+      bool patternQuery;
+      bool headerQuery;
+      int8_t patternCount = splitNodes(pattern, patternNodes, patternQuery, true);
+      int8_t headerCount = splitNodes(header, headerNodes, headerQuery, false);
+      if (patternCount < 0 || headerCount < 0 || patternQuery != headerQuery) {
+        return false;
+      }
+      return matchNodes(patternNodes, patternCount, headerNodes, headerCount);
+    }
+
+  private:
+    // Unit suffix and its power of ten against the base unit
+    struct Unit {
+      const char* name;
+      int8_t exponent;
+    };
+
+    // One node of a header: keyword text and whether it is optional
+    struct Node {
+      const char* text;
+      uint8_t length;
+      bool optional;
+    };
+
+    // Resolve and run one command; path holds the previous command's path
+    int16_t dispatch(const char* header, const char* parameter, char* path, bool& responded) {
+      bool query = header[strlen(header) - 1] == '?';
+
+      // Relative headers continue from the previous command's path
+      char full[ADF4351_SCPI_MAX_HEADER];
+      const ADF4351ScpiCommand* command = NULL;
+      if (*header != '*' && *header != ':' && *path != '\0' &&
+          strlen(path) + strlen(header) < sizeof(full)) {
+        strcpy(full, path);
+        strcat(full, header);
+        command = find(full);
+      }
+      if (command == NULL) {
+        if (strlen(header) >= sizeof(full)) {
+          return ADF4351_SCPI_UNDEFINED_HEADER;
+        }
+        strcpy(full, header);
+        command = find(full);
+      }
+
+      // Built-in error queue commands
+      bool builtIn = false;
+      if (command == NULL) {
+        builtIn = matchHeader("SYSTem:ERRor[:NEXT]?", full) || matchHeader("*CLS", full);
+        if (!builtIn) {
+          return ADF4351_SCPI_UNDEFINED_HEADER;
+        }
+      }
+
+      // Common commands leave the path alone; others set it to their own
+      if (*full != '*') {
+        char* end = strrchr(full, ':');
+        uint8_t length = end == NULL ? 0 : end - full + 1;
+        memcpy(path, full, length);
+        path[length] = '\0';
+      }
+
+      if (query) {
+        if (*parameter != '\0') {
+          return ADF4351_SCPI_PARAMETER_NOT_ALLOWED;
+        }
+        if (responded) {
+          _out.print(';');
+        }
+        responded = true;
+      }
+
+      if (builtIn) {
+        if (!query) {
+          clearErrors();
+          return ADF4351_SCPI_NO_ERROR;
+        }
+        int16_t code = popError();
+        _out.print(code);
+        _out.print(",\"");
+        _out.print(errorMessage(code));
+        _out.print('"');
+        return ADF4351_SCPI_NO_ERROR;
+      }
+      return command->handler(parameter, _out);
+    }
+
+    // First command whose header pattern matches
+    const ADF4351ScpiCommand* find(const char* header) {
+      for (uint8_t i = 0; i < _count; i++) {
+        if (matchHeader(_commands[i].header, header)) {
+          return &_commands[i];
+        }
+      }
+      return NULL;
+    }
+
+    // Split a header into nodes at ':'; patterns may bracket optional
+    // nodes ("[SOURce]:FREQuency[:CW]"). Returns the count, or -1
+    static int8_t splitNodes(const char* text, Node* nodes, bool& query, bool pattern) {
+      uint8_t length = strlen(text);
+      query = length > 0 && text[length - 1] == '?';
+      if (query) {
+        length--;
+      }
+
+      int8_t count = 0;
+      uint8_t i = 0;
+      if (i < length && text[i] == ':') {
+        i++;
+      }
+      while (i < length) {
+        bool optional = false;
+        if (pattern && text[i] == '[') {
+          optional = true;
+          i++;
+          if (i < length && text[i] == ':') {
+            i++;
+          }
+        }
+        uint8_t start = i;
+        while (i < length && text[i] != ':' && text[i] != '[' && text[i] != ']') {
+          i++;
+        }
+        if (i == start || count == ADF4351_SCPI_MAX_NODES) {
+          return -1;
+        }
+        nodes[count++] = {text + start, (uint8_t)(i - start), optional};
+        if (optional) {
+          if (i >= length || text[i] != ']') {
+            return -1;
+          }
+          i++;
+        } else if (i < length && text[i] != ':' && !(pattern && text[i] == '[')) {
+          return -1;
+        }
+        if (i < length && text[i] == ':') {
+          i++;
+          if (i == length) {
+            return -1;
+          }
+        }
+      }
+      return count;
+    }
+
+    // Match pattern nodes against header nodes, trying optional nodes
+    // both present and left out
+    static bool matchNodes(const Node* pattern, int8_t patternCount, const Node* header, int8_t headerCount) {
+      if (patternCount == 0) {
+        return headerCount == 0;
+      }
+      if (headerCount > 0 && matchKeyword(pattern[0], header[0]) &&
+          matchNodes(pattern + 1, patternCount - 1, header + 1, headerCount - 1)) {
+        return true;
+      }
+      return pattern[0].optional && matchNodes(pattern + 1, patternCount - 1, header, headerCount);
+    }
+
+    // A keyword matches in its short form (the upper case part of the
+    // pattern) or its long form, in any case
+    static bool matchKeyword(const Node& pattern, const Node& word) {
+      uint8_t shortLength = 0;
+      while (shortLength < pattern.length &&
+             !(pattern.text[shortLength] >= 'a' && pattern.text[shortLength] <= 'z')) {
+        shortLength++;
+      }
+      if (word.length != shortLength && word.length != pattern.length) {
+        return false;
+      }
+      for (uint8_t i = 0; i < word.length; i++) {
+        if (toUpper(pattern.text[i]) != toUpper(word.text[i])) {
+          return false;
+        }
+      }
+      return true;
+    }
+
+    // Parse a decimal number with optional fraction, exponent and unit
+    // suffix into the base unit, rounded to an integer
+    static int16_t parseNumber(const char* text, const Unit* units, uint8_t unitCount,
+                               int8_t defaultExponent, uint32_t& value) {
+      if (*text == '\0') {
+        return ADF4351_SCPI_MISSING_PARAMETER;
+      }
+      if (*text == '+') {
+        text++;
+      } else if (*text == '-') {
+        return ADF4351_SCPI_OUT_OF_RANGE;
+      }
+
+      // Mantissa: up to 18 significant digits, the rest only scale it
+      uint64_t mantissa = 0;
+      int16_t exponent = 0;
+      uint8_t digits = 0;
+      bool point = false;
+      for (; (*text >= '0' && *text <= '9') || (*text == '.' && !point); text++) {
+        if (*text == '.') {
+          point = true;
+        } else if (mantissa < 100000000000000000ULL) {
+          mantissa = mantissa * 10 + (*text - '0');
+          exponent -= point;
+          digits++;
+        } else {
+          exponent += !point;
+          digits++;
+        }
+      }
+      if (digits == 0) {
+        return ADF4351_SCPI_DATA_TYPE_ERROR;
+      }
+
+      // Exponent
+      if (*text == 'e' || *text == 'E') {
+        text++;
+        bool negative = *text == '-';
+        if (*text == '+' || *text == '-') {
+          text++;
+        }
+        if (*text < '0' || *text > '9') {
+          return ADF4351_SCPI_SYNTAX_ERROR;
+        }
+        int16_t e = 0;
+        for (; *text >= '0' && *text <= '9'; text++) {
+          if (e < 100) e = e * 10 + (*text - '0');
+        }
+        exponent += negative ? -e : e;
+      }
+
+      // Unit suffix, optionally after white space
+      while (*text == ' ' || *text == '\t') {
+        text++;
+      }
+      if (*text == '\0') {
+        exponent += defaultExponent;
+      } else {
+        uint8_t i = 0;
+        while (i < unitCount && !equalsIgnoreCase(text, units[i].name)) {
+          i++;
+        }
+        if (i == unitCount) {
+          return ADF4351_SCPI_INVALID_SUFFIX;
+        }
+        exponent += units[i].exponent;
+      }
+
+      // Scale to the base unit
+      if (mantissa == 0) {
+        value = 0;
+        return ADF4351_SCPI_NO_ERROR;
+      }
+      for (; exponent > 0; exponent--) {
+        mantissa *= 10;
+        if (mantissa > 0xFFFFFFFFUL) {
+          return ADF4351_SCPI_OUT_OF_RANGE;
+        }
+      }
+      if (exponent < -19) {
+        mantissa = 0;
+      }
+      for (; exponent < 0 && mantissa > 0; exponent++) {
+        mantissa = exponent == -1 ? (mantissa + 5) / 10 : mantissa / 10;
+      }
+      if (mantissa > 0xFFFFFFFFUL) {
+        return ADF4351_SCPI_OUT_OF_RANGE;
+      }
+      value = (uint32_t)mantissa;
+      return ADF4351_SCPI_NO_ERROR;
+    }
+
+    static char toUpper(char c) {
+      return c >= 'a' && c <= 'z' ? c - ('a' - 'A') : c;
+    }
+
+    static bool equalsIgnoreCase(const char* a, const char* b) {
+      for (; *a != '\0' && *b != '\0'; a++, b++) {
+        if (toUpper(*a) != toUpper(*b)) {
+          return false;
+        }
+      }
+      return *a == *b;
+    }
+
+    // Strip spaces and tabs at both ends in place
+    static char* trim(char* text) {
+      while (*text == ' ' || *text == '\t') {
+        text++;
+      }
+      char* end = text + strlen(text);
+      while (end > text && (end[-1] == ' ' || end[-1] == '\t')) {
+        end--;
+      }
+      *end = '\0';
+      return text;
+    }
+
+    const ADF4351ScpiCommand* _commands;
+    uint8_t _count;
+    Print& _out;
+    int16_t _errors[ADF4351_SCPI_ERROR_QUEUE];
+    uint8_t _errorCount;
+};
+
+#endif
@@ -0,0 +1,250 @@
+/*
+ * ADF4351_Sweeper.h - Timer driven sweep engine for the ADF4351 library
+ *
+ * Steps through a precompiled ADF4351SweepPlan from a pico-sdk repeating
+ * timer, so the dwell time has microsecond resolution and does not depend
+ * on what loop() is doing. Each timer interrupt streams one step's words
+ * (usually just R0) to the transport.
+ *
+ * The timer is created with a negative period, which schedules every
+ * step relative to the previous target time rather than the end of the
+ * previous callback, so the step rate does not drift. The lateness of
+ * each step against that schedule is recorded as the jitter. A step that
+ * comes a whole dwell late means the transport or the interrupt load
+ * cannot keep up with the dwell; the sweep then stops and the stats
+ * report the overrun instead of steps silently bunching up.
+ *
+ * The timer interrupt fires on the core its alarm pool was created on.
+ * That is core 0 for the SDK's default pool, where USB serial competes
+ * with it; to step from core 1, create a pool there and hand it over:
+ *
+ *   void setup1() {
+ *     sweeper.setAlarmPool(alarm_pool_create_with_unused_hardware_alarm(4));
+ *   }
+ *
+ * For step rates in the tens of kHz use the SPI or PIO transport; the
+ * digitalWrite bit-bang takes ~70 us per word.
+ *
+ * The driver must not be used from other code while a sweep runs.
+ *
+ * Created: October 2026
+ */
+
+#ifndef ADF4351_SWEEPER_H
+#define ADF4351_SWEEPER_H
+
+#include <Arduino.h>
+#include <pico/time.h>
+#include <hardware/sync.h>
+#include "ADF4351.h"
+
+// Shortest dwell time the sweeper accepts (us)
+#ifndef ADF4351_SWEEP_MIN_DWELL
+#define ADF4351_SWEEP_MIN_DWELL 10
+#endif
+
+// Step timing of a running or finished sweep
+struct ADF4351SweepStats {
+  uint32_t steps;        // Steps written
+  uint32_t cycles;       // Complete passes through the plan
+  uint32_t minLate;      // Smallest lateness against the schedule (us)
+  uint32_t maxLate;      // Largest lateness against the schedule (us)
+  uint64_t totalLate;    // Sum of lateness over the timed steps, all but
+                         // the first (mean = totalLate / (steps - 1))
+  uint32_t maxStepTime;  // Longest time spent writing one step (us)
+  bool overrun;          // Stopped because a step came a dwell or more late
+};
+
+template <class Bus>
+class ADF4351Sweeper {
+  public:
+    // Constructor
+    explicit ADF4351Sweeper(ADF4351T<Bus>& adf);
+
+    // Start stepping through plan every dwell_us microseconds, from its
+    // first step; repeat = false stops after the last step
+    // Returns false if the plan is empty, the dwell is below
+    // ADF4351_SWEEP_MIN_DWELL or no timer is free
+    bool start(const ADF4351SweepPlan& plan, uint32_t dwell_us, bool repeat = true);
+
+    // Stop the sweep (the last step stays set)
+    void stop();
+
+    // Alarm pool the step timer is added to; NULL (the default) uses the
+    // SDK's default pool, whose interrupt is on core 0
+    void setAlarmPool(alarm_pool_t* pool);
+
+    // True while the timer is running (false after an overrun)
+    bool isRunning();
+
+    // Get a snapshot of the step timing
+    // Jitter is maxLate - minLate
+    ADF4351SweepStats getStats();
+
+  private:
+    static bool onTimer(repeating_timer_t* timer);
+    uint32_t statsEnter();
+    void statsExit(uint32_t save);
+
+    ADF4351T<Bus>& _adf;
+    const ADF4351SweepPlan* _plan;
+    alarm_pool_t* _pool;
+    repeating_timer_t _timer;
+    volatile bool _running;
+    bool _repeat;
+    uint32_t _dwell;            // Step period (us)
+    uint32_t _position;         // Word position of the next step
+    uint32_t _nextTime;         // Scheduled time of the next step (us)
+
+    // Written by the timer interrupt, which may be on the other core from
+    // getStats(), so guarded by a hardware spinlock
+    ADF4351SweepStats _stats;
+    spin_lock_t* _statsLock;    // Claimed by the first start(), NULL before
+};
+
+template <class Bus>
+ADF4351Sweeper<Bus>::ADF4351Sweeper(ADF4351T<Bus>& adf)
+  : _adf(adf), _plan(NULL), _pool(NULL), _running(false), _repeat(true), _dwell(0), _position(0), _nextTime(0),
+    _statsLock(NULL) {
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+// Start stepping through a plan
+template <class Bus>
+bool ADF4351Sweeper<Bus>::start(const ADF4351SweepPlan& plan, uint32_t dwell_us, bool repeat) {
+  stop();
+  if (plan.getStepCount() == 0 || dwell_us < ADF4351_SWEEP_MIN_DWELL) {
+    return false;
+  }
+
+  if (_statsLock == NULL) {
+    _statsLock = spin_lock_instance(spin_lock_claim_unused(true));
+  }
+  _plan = &plan;
+  _repeat = repeat;
+  _dwell = dwell_us;
+
+  // First step right away, the timer takes over from there
+  uint32_t now = time_us_32();
+  _position = _adf.sweepStep(plan, 0);
+  uint32_t stepTime = time_us_32() - now;
+  _nextTime = now + dwell_us;
+  bool finished = _position == 0 && !repeat;
+
+  uint32_t save = statsEnter();
+  memset(&_stats, 0, sizeof(_stats));
+  _stats.steps = 1;
+  _stats.maxStepTime = stepTime;
+  _stats.cycles = finished ? 1 : 0;
+  statsExit(save);
+  if (finished) {
+    return true;
+  }
+
+  // Negative delay: period measured between scheduled start times
+  alarm_pool_t* pool = _pool != NULL ? _pool : alarm_pool_get_default();
+  _running = true;
+  if (!alarm_pool_add_repeating_timer_us(pool, -(int64_t)dwell_us, onTimer, this, &_timer)) {
+    _running = false;
+    return false;
+  }
+  return true;
+}
+
+// Stop the sweep
+template <class Bus>
+void ADF4351Sweeper<Bus>::stop() {
+  if (_running) {
+    cancel_repeating_timer(&_timer);
+    _running = false;
+  }
+}
+
+// Select the alarm pool for the step timer
+template <class Bus>
+void ADF4351Sweeper<Bus>::setAlarmPool(alarm_pool_t* pool) {
+  _pool = pool;
+}
+
+// True while the timer is running
+template <class Bus>
+bool ADF4351Sweeper<Bus>::isRunning() {
+  return _running;
+}
+
+// Get a snapshot of the step timing
+template <class Bus>
+ADF4351SweepStats ADF4351Sweeper<Bus>::getStats() {
+  uint32_t save = statsEnter();
+  ADF4351SweepStats stats = _stats;
+  statsExit(save);
+  return stats;
+}
+
+// Hold off the timer interrupt on both cores; returns the interrupt
+// state for statsExit(). Before start() no timer runs on either core
+template <class Bus>
+uint32_t ADF4351Sweeper<Bus>::statsEnter() {
+  if (_statsLock == NULL) {
+    return save_and_disable_interrupts();
+  }
+  return spin_lock_blocking(_statsLock);
+}
+
+// Release statsEnter()
+template <class Bus>
+void ADF4351Sweeper<Bus>::statsExit(uint32_t save) {
+  if (_statsLock == NULL) {
+    restore_interrupts(save);
+  } else {
+    spin_unlock(_statsLock, save);
+  }
+}
+
+// Timer interrupt: write one step
+template <class Bus>
+bool ADF4351Sweeper<Bus>::onTimer(repeating_timer_t* timer) {
+  ADF4351Sweeper<Bus>* sweeper = (ADF4351Sweeper<Bus>*)timer->user_data;
+  ADF4351SweepStats& stats = sweeper->_stats;
+  uint32_t save;
+
+  // Lateness against the ideal schedule; a dwell or more means steps
+  // are being missed
+  uint32_t now = time_us_32();
+  uint32_t late = now - sweeper->_nextTime;
+  if (late >= sweeper->_dwell) {
+    save = sweeper->statsEnter();
+    stats.overrun = true;
+    sweeper->statsExit(save);
+    sweeper->_running = false;
+    return false;
+  }
+  sweeper->_nextTime += sweeper->_dwell;
+
+  // Position 0 means the previous step was the last one
+  bool wrapped = sweeper->_position == 0;
+  sweeper->_position = sweeper->_adf.sweepStep(*sweeper->_plan, sweeper->_position);
+  uint32_t stepTime = time_us_32() - now;
+
+  // Single pass: stop once the last step has been written
+  bool finished = sweeper->_position == 0 && !sweeper->_repeat;
+
+  // Update the stats in one go, outside the register write
+  save = sweeper->statsEnter();
+  if (stats.steps == 1 || late < stats.minLate) stats.minLate = late;
+  if (late > stats.maxLate) stats.maxLate = late;
+  stats.totalLate += late;
+  if (wrapped) stats.cycles++;
+  stats.steps++;
+  if (stepTime > stats.maxStepTime) stats.maxStepTime = stepTime;
+  if (finished) stats.cycles++;
+  sweeper->statsExit(save);
+
+  if (finished) {
+    sweeper->_running = false;
+    return false;
+  }
+  return true;
+}
+
+#endif
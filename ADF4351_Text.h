@@ -0,0 +1,199 @@
+/*
+ * ADF4351_Text.h - Allocation-free text helpers for the ADF4351 sketches
+ *
+ * Commands are read into a fixed char buffer and split in place, so
+ * parsing never touches the heap:
+ *
+ *   char* tokens[4];
+ *   ADF4351Text::toLower(line);
+ *   uint8_t count = ADF4351Text::tokenize(line, tokens, 4);
+ *   uint32_t frequency;
+ *   if (count == 2 && ADF4351Text::parseUint(tokens[1], frequency)) ...
+ *
+ * Frequencies are formatted with integer arithmetic only, exact to 1 Hz
+ * at any magnitude, without float printf:
+ *
+ *   char text[24];
+ *   ADF4351Text::formatFrequency(text, sizeof(text), 145012500, ADF4351_UNIT_AUTO, ' ');
+ *   // "145.012 500 MHz"
+ *
+ * Created: October 2026
+ */
+
+#ifndef ADF4351_TEXT_H
+#define ADF4351_TEXT_H
+
+#include <Arduino.h>
+
+// Units for ADF4351Text::formatFrequency()
+enum ADF4351FrequencyUnit {
+  ADF4351_UNIT_AUTO,  // kHz below 1 MHz, MHz below 1 GHz, GHz above
+  ADF4351_UNIT_HZ,
+  ADF4351_UNIT_KHZ,
+  ADF4351_UNIT_MHZ,
+  ADF4351_UNIT_GHZ
+};
+
+// Longest formatted frequency, with grouping, unit and terminator
+// ("4.294 967 295 GHz")
+#define ADF4351_FREQUENCY_TEXT 24
+
+class ADF4351Text {
+  public:
+    // Convert ASCII letters to lower case in place
+    static void toLower(char* text) {
+      for (; *text != '\0'; text++) {
+        if (*text >= 'A' && *text <= 'Z') {
+          *text += 'a' - 'A';
+        }
+      }
+    }
+
+    // Split text in place at spaces and tabs: each token is terminated
+    // and stored in tokens. Returns the number of tokens, at most
+    // maxTokens; anything after the last one stays in the last token
+    static uint8_t tokenize(char* text, char** tokens, uint8_t maxTokens) {
+      uint8_t count = 0;
+      while (count < maxTokens) {
+        while (isSpace(*text)) {
+          text++;
+        }
+        if (*text == '\0') {
+          break;
+        }
+        tokens[count++] = text;
+        if (count == maxTokens) {
+          // Keep the remainder, trimmed at the end
+          char* end = text + strlen(text);
+          while (end > text && isSpace(end[-1])) {
+            end--;
+          }
+          *end = '\0';
+          break;
+        }
+        while (*text != '\0' && !isSpace(*text)) {
+          text++;
+        }
+        if (*text != '\0') {
+          *text++ = '\0';
+        }
+      }
+      return count;
+    }
+
+    // Parse an unsigned decimal number; false if the text is empty, holds
+    // anything but digits or does not fit in 32 bits
+    static bool parseUint(const char* text, uint32_t& value) {
+      if (*text == '\0') {
+        return false;
+      }
+
+      uint32_t result = 0;
+      for (; *text != '\0'; text++) {
+        if (*text < '0' || *text > '9') {
+          return false;
+        }
+        uint32_t digit = *text - '0';
+        if (result > (0xFFFFFFFFUL - digit) / 10) {
+          return false;
+        }
+        result = result * 10 + digit;
+      }
+      value = result;
+      return true;
+    }
+
+    // Parse an unsigned decimal number with at most decimals fraction
+    // digits, scaled by 10^decimals without floating point:
+    // parseDecimal("145.5", 6, value) gives 145500000
+    // False if the text is malformed, has more fraction digits or the
+    // result does not fit in 32 bits
+    static bool parseDecimal(const char* text, uint8_t decimals, uint32_t& value) {
+      uint64_t result = 0;
+      uint8_t digits = 0;
+      int8_t fraction = -1;  // Fraction digits so far, -1 before the point
+      for (; *text != '\0'; text++) {
+        if (*text == '.' && fraction < 0) {
+          fraction = 0;
+          continue;
+        }
+        if (*text < '0' || *text > '9' || (fraction >= 0 && fraction++ >= decimals)) {
+          return false;
+        }
+        result = result * 10 + (*text - '0');
+        digits++;
+        if (result > 0xFFFFFFFFUL) {
+          return false;
+        }
+      }
+      if (digits == 0) {
+        return false;
+      }
+
+      // Scale up for the fraction digits not given
+      for (int8_t i = fraction < 0 ? 0 : fraction; i < decimals; i++) {
+        result *= 10;
+        if (result > 0xFFFFFFFFUL) {
+          return false;
+        }
+      }
+      value = (uint32_t)result;
+      return true;
+    }
+
+    // Format frequency (Hz) in unit, with every digit down to 1 Hz and the
+    // unit name appended: "145.012500 MHz". A non-zero separator groups
+    // the digits in threes on both sides of the point: "145.012 500 MHz"
+    // with ' '. Use ' ' or ','; '.' would read as a second decimal point
+    // Returns the length, or 0 (and an empty buffer) if it does not fit
+    static uint8_t formatFrequency(char* buffer, uint8_t size, uint32_t frequency,
+                                   uint8_t unit = ADF4351_UNIT_AUTO, char separator = 0) {
+      if (unit == ADF4351_UNIT_AUTO) {
+        unit = frequency < 1000000 ? ADF4351_UNIT_KHZ :
+               frequency < 1000000000UL ? ADF4351_UNIT_MHZ : ADF4351_UNIT_GHZ;
+      } else if (unit > ADF4351_UNIT_GHZ) {
+        unit = ADF4351_UNIT_GHZ;
+      }
+      static const char* const names[] = {"", " Hz", " kHz", " MHz", " GHz"};
+      uint8_t decimals = 3 * (unit - ADF4351_UNIT_HZ);
+
+      // Built backwards from the end of the unit name
+      char text[ADF4351_FREQUENCY_TEXT];
+      char* p = text + sizeof(text);
+      *--p = '\0';
+      const char* name = names[unit];
+      for (const char* end = name + strlen(name); end > name;) {
+        *--p = *--end;
+      }
+
+      // Fraction digits, then the point, then the integer part
+      uint8_t digits = 0;
+      do {
+        // Digits written on this side of the point so far
+        uint8_t group = digits > decimals ? digits - decimals : digits;
+        if (digits == decimals && decimals > 0) {
+          *--p = '.';
+        } else if (separator != 0 && group > 0 && group % 3 == 0) {
+          *--p = separator;
+        }
+        *--p = '0' + frequency % 10;
+        frequency /= 10;
+        digits++;
+      } while (frequency > 0 || digits <= decimals);
+
+      uint8_t length = text + sizeof(text) - 1 - p;
+      if (length >= size) {
+        if (size > 0) buffer[0] = '\0';
+        return 0;
+      }
+      memcpy(buffer, p, length + 1);
+      return length;
+    }
+
+  private:
+    static inline bool isSpace(char c) {
+      return c == ' ' || c == '\t';
+    }
+};
+
+#endif
@@ -0,0 +1,292 @@
+/*
+ * ADF4351 Benchmark
+ *
+ * This sketch measures the library's calculations on the target board.
+ * No ADF4351 needs to be connected; results are printed once at startup.
+ *
+ * Frequency solver: the integer ADF4351Base::solve() against the previous
+ * double-precision calculation (fixed MOD = 1000, FRAC truncated), timed
+ * and checked for output frequency error from 35 MHz to 4.29 GHz.
+ *
+ * Command parser: the controller's previous String based parsing (trim,
+ * toLowerCase, substring, toInt) against the fixed buffer tokenizer in
+ * ADF4351_Text.h and the hashed command table in ADF4351_Commands.h, per
+ * command.
+ *
+ * Frequency formatter: the previous float sprintf() formatting of the
+ * VFO display against the integer ADF4351Text::formatFrequency(), per
+ * call (the display refresh formats every 100 ms).
+ *
+ * Created: October 2026
+ */
+
+#include "ADF4351.h"
+#include "ADF4351_Text.h"
+#include "ADF4351_Commands.h"
+
+// Reference frequency (Hz)
+const uint32_t REF_FREQ = 25000000; // 25 MHz reference
+
+// Solver sweep: odd step so the fractional part varies from point to point
+const uint32_t SOLVER_START = 35000000;    // 35 MHz
+const uint32_t SOLVER_STOP = 4294000000UL; // Top of the uint32_t range
+const uint32_t SOLVER_STEP = 1000003;      // ~1 MHz
+
+// Parser benchmark: typical controller commands and repetitions per command
+const char* PARSER_COMMANDS[] = {"freq 145000000", "power 3", "phase 90", "FastLock auto", "status"};
+const uint8_t PARSER_COMMAND_COUNT = sizeof(PARSER_COMMANDS) / sizeof(PARSER_COMMANDS[0]);
+const uint32_t PARSER_REPEAT = 10000;
+
+// Formatter benchmark: one frequency per unit range, repetitions of each
+const uint32_t FORMAT_FREQUENCIES[] = {455000, 145012500, 1296000000UL};
+const uint8_t FORMAT_FREQUENCY_COUNT = sizeof(FORMAT_FREQUENCIES) / sizeof(FORMAT_FREQUENCIES[0]);
+const uint32_t FORMAT_REPEAT = 5000;
+
+// Keeps the compiler from optimizing the timed loops away
+volatile uint32_t benchSink = 0;
+
+void setup() {
+  // Initialize serial communication
+  Serial.begin(115200);
+  while (!Serial) {
+    ; // Wait for serial port to connect
+  }
+
+  Serial.println("ADF4351 Benchmark");
+  Serial.println("-----------------");
+
+  runSolverBenchmark();
+  runParserBenchmark();
+  runFormatBenchmark();
+}
+
+void loop() {
+}
+
+// Previous double-precision calculation from updateRegisters(), kept verbatim
+bool legacySolve(uint32_t frequency, uint32_t pfdFreq, ADF4351Solution& solution) {
+  uint8_t divider;
+  if (frequency < 68750000) {
+    divider = 6;
+  } else if (frequency < 137500000) {
+    divider = 5;
+  } else if (frequency < 275000000) {
+    divider = 4;
+  } else if (frequency < 550000000) {
+    divider = 3;
+  } else if (frequency < 1100000000) {
+    divider = 2;
+  } else if (frequency < 2200000000UL) {
+    divider = 1;
+  } else {
+    divider = 0;
+  }
+  uint8_t rfDivider = 1 << divider;
+  uint32_t vcoFreq = frequency * rfDivider;
+
+  uint16_t mod = 1000;
+  uint16_t intValue = vcoFreq / pfdFreq;
+  uint32_t fracValue = (uint32_t)((((double)vcoFreq / (double)pfdFreq) - intValue) * mod);
+
+  solution.intValue = intValue;
+  solution.frac = fracValue;
+  solution.mod = mod;
+  solution.divider = divider;
+  return true;
+}
+
+// Output frequency error of a solution in millihertz
+int64_t solutionError(uint32_t frequency, uint32_t pfdFreq, const ADF4351Solution& solution) {
+  // PFD * (INT * MOD + FRAC) - requested VCO * MOD, over MOD * RF divider
+  int64_t n = (int64_t)solution.intValue * solution.mod + solution.frac;
+  int64_t numerator = n * pfdFreq - ((int64_t)frequency << solution.divider) * solution.mod;
+  int64_t denominator = (int64_t)solution.mod << solution.divider;
+  return numerator * 1000 / denominator;
+}
+
+// Time and check one solver over the whole sweep
+void benchSolver(const char* name, bool (*solver)(uint32_t, uint32_t, ADF4351Solution&)) {
+  ADF4351Solution solution;
+  uint32_t points = 0;
+  uint32_t exact = 0;
+  int64_t worstError = 0;
+
+  // Timed pass
+  unsigned long startTime = micros();
+  for (uint32_t f = SOLVER_START; f <= SOLVER_STOP && f >= SOLVER_START; f += SOLVER_STEP) {
+    solver(f, REF_FREQ, solution);
+    benchSink += solution.frac;
+    points++;
+  }
+  unsigned long elapsed = micros() - startTime;
+
+  // Accuracy pass
+  for (uint32_t f = SOLVER_START; f <= SOLVER_STOP && f >= SOLVER_START; f += SOLVER_STEP) {
+    if (!solver(f, REF_FREQ, solution)) {
+      continue;
+    }
+    int64_t error = solutionError(f, REF_FREQ, solution);
+    if (error < 0) error = -error;
+    if (error == 0) exact++;
+    if (error > worstError) worstError = error;
+  }
+
+  Serial.print(name);
+  Serial.print(": ");
+  Serial.print(points);
+  Serial.print(" points, ");
+  Serial.print(elapsed * 1000.0 / points, 1);
+  Serial.print(" ns/solve, worst error ");
+  Serial.print((uint32_t)worstError);
+  Serial.print(" mHz, exact ");
+  Serial.print(exact);
+  Serial.print("/");
+  Serial.println(points);
+}
+
+void runSolverBenchmark() {
+  Serial.println("\nFrequency solver (35 MHz - 4.29 GHz, 25 MHz PFD):");
+  benchSolver("double, MOD=1000", legacySolve);
+  benchSolver("integer solve() ", ADF4351Base::solve);
+  Serial.println();
+}
+
+// Previous String based parsing from ADF4351_Controller.ino: returns the
+// numeric argument of the recognised command
+uint32_t legacyParse(const char* line) {
+  String command = line;
+  command.trim();
+  command.toLowerCase();
+
+  if (command.startsWith("freq ")) {
+    return command.substring(5).toInt();
+  } else if (command.startsWith("power ")) {
+    return command.substring(6).toInt();
+  } else if (command.startsWith("phase ")) {
+    return command.substring(6).toInt();
+  } else if (command.startsWith("fastlock ")) {
+    return command.substring(9).length();
+  } else if (command == "status") {
+    return 1;
+  }
+  return 0;
+}
+
+// Fixed buffer parsing as in ADF4351_Controller.ino now
+uint32_t bufferParse(const char* line) {
+  char buffer[64];
+  strncpy(buffer, line, sizeof(buffer) - 1);
+  buffer[sizeof(buffer) - 1] = '\0';
+
+  char* tokens[4];
+  ADF4351Text::toLower(buffer);
+  uint8_t count = ADF4351Text::tokenize(buffer, tokens, 4);
+  uint32_t value = 0;
+  if (count == 2) {
+    if (!ADF4351Text::parseUint(tokens[1], value)) {
+      value = strlen(tokens[1]);
+    }
+  } else if (count == 1) {
+    value = 1;
+  }
+  return value;
+}
+
+// Hashed command table over the controller's command names; the handler
+// only keeps the parsed argument
+void benchHandler(const ADF4351CommandArgs& args) {
+  benchSink += args.present ? args.value + strlen(args.text) : 1;
+}
+
+constexpr ADF4351CommandSpec BENCH_SPECS[] = {
+  {"freq", ADF4351_ARG_UINT, benchHandler},
+  {"power", ADF4351_ARG_UINT, benchHandler},
+  {"on", ADF4351_ARG_NONE, benchHandler},
+  {"off", ADF4351_ARG_NONE, benchHandler},
+  {"phase", ADF4351_ARG_UINT, benchHandler},
+  {"lownoise", ADF4351_ARG_NONE, benchHandler},
+  {"lowspur", ADF4351_ARG_NONE, benchHandler},
+  {"fastlock", ADF4351_ARG_TEXT, benchHandler},
+  {"csr", ADF4351_ARG_TEXT, benchHandler},
+  {"status", ADF4351_ARG_NONE, benchHandler},
+  {"stats", ADF4351_ARG_TEXT | ADF4351_ARG_OPTIONAL, benchHandler},
+  {"binary", ADF4351_ARG_NONE, benchHandler},
+  {"help", ADF4351_ARG_NONE, benchHandler}
+};
+constexpr ADF4351CommandTable benchCommands(BENCH_SPECS);
+static_assert(benchCommands.isPerfect(), "Command names must be unique");
+
+uint32_t tableParse(const char* line) {
+  char buffer[64];
+  strncpy(buffer, line, sizeof(buffer) - 1);
+  buffer[sizeof(buffer) - 1] = '\0';
+  return benchCommands.execute(buffer);
+}
+
+// Time one parser over all sample commands
+void benchParser(const char* name, uint32_t (*parser)(const char*)) {
+  unsigned long startTime = micros();
+  for (uint32_t i = 0; i < PARSER_REPEAT; i++) {
+    for (uint8_t c = 0; c < PARSER_COMMAND_COUNT; c++) {
+      benchSink += parser(PARSER_COMMANDS[c]);
+    }
+  }
+  unsigned long elapsed = micros() - startTime;
+
+  Serial.print(name);
+  Serial.print(": ");
+  Serial.print(elapsed * 1000.0 / (PARSER_REPEAT * PARSER_COMMAND_COUNT), 1);
+  Serial.println(" ns/command");
+}
+
+void runParserBenchmark() {
+  Serial.println("Command parser (5 sample commands, line copy included):");
+  benchParser("String (previous)", legacyParse);
+  benchParser("fixed buffer     ", bufferParse);
+  benchParser("hashed table     ", tableParse);
+  Serial.println();
+}
+
+// Previous float formatting from VFO_Interface.ino
+uint32_t legacyFormat(uint32_t frequency, char* buffer) {
+  if (frequency < 1000000) {
+    sprintf(buffer, "Freq: %7.3f kHz", frequency / 1000.0);
+  } else if (frequency < 1000000000UL) {
+    sprintf(buffer, "Freq: %9.6f MHz", frequency / 1000000.0);
+  } else {
+    sprintf(buffer, "Freq: %6.6f GHz", frequency / 1000000000.0);
+  }
+  return strlen(buffer);
+}
+
+// Integer formatting as in the examples now
+uint32_t integerFormat(uint32_t frequency, char* buffer) {
+  return ADF4351Text::formatFrequency(buffer, ADF4351_FREQUENCY_TEXT, frequency, ADF4351_UNIT_AUTO, ' ');
+}
+
+// Time one formatter over the sample frequencies
+void benchFormat(const char* name, uint32_t (*formatter)(uint32_t, char*)) {
+  char buffer[32];
+  unsigned long startTime = micros();
+  for (uint32_t i = 0; i < FORMAT_REPEAT; i++) {
+    for (uint8_t f = 0; f < FORMAT_FREQUENCY_COUNT; f++) {
+      benchSink += formatter(FORMAT_FREQUENCIES[f], buffer);
+    }
+  }
+  unsigned long elapsed = micros() - startTime;
+
+  Serial.print(name);
+  Serial.print(": ");
+  Serial.print(elapsed * 1000.0 / (FORMAT_REPEAT * FORMAT_FREQUENCY_COUNT), 1);
+  Serial.print(" ns/call, e.g. \"");
+  formatter(FORMAT_FREQUENCIES[FORMAT_FREQUENCY_COUNT - 1], buffer);
+  Serial.print(buffer);
+  Serial.println("\"");
+}
+
+void runFormatBenchmark() {
+  Serial.println("Frequency formatter (kHz, MHz and GHz samples):");
+  benchFormat("float sprintf (previous)", legacyFormat);
+  benchFormat("integer formatFrequency ", integerFormat);
+  Serial.println();
+}
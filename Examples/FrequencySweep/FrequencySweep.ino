@@ -4,33 +4,62 @@
  * This example demonstrates how to perform a frequency sweep with the ADF4351
  * which is useful for testing filters, antennas, and other RF components.
  * 
+ * The sweep is solved into a plan of register words when it starts, so
+ * each step only streams the words that change. "start" paces the steps
+ * from loop() and moves on as soon as the PLL reports lock; "fast <us>"
+ * hands the plan to a hardware timer for microsecond dwell times.
+ * 
  * Created: March 2025
  */
 
 #include "ADF4351.h"
+#include "ADF4351_Sweeper.h"
+#include "ADF4351_Output.h"
+#include "ADF4351_Commands.h"
 
 // Pin definitions
 #define ADF4351_LE_PIN   5  // Latch Enable Pin
 #define ADF4351_CLK_PIN  2  // Clock Pin
 #define ADF4351_DATA_PIN 3  // Data Pin
 #define ADF4351_CE_PIN   4  // Chip Enable Pin
+#define ADF4351_LD_PIN   6  // Lock Detect Pin (LD or MUXOUT)
 
 // Reference frequency (Hz)
 const uint32_t REF_FREQ = 25000000; // 25 MHz reference
 
-// Create ADF4351 instance
-ADF4351 adf4351(ADF4351_LE_PIN, ADF4351_CLK_PIN, ADF4351_DATA_PIN, ADF4351_CE_PIN);
+// Create ADF4351 instance on the PIO transport, which queues a step's
+// words without waiting for them to shift out
+ADF4351T<ADF4351PioBus<ADF4351_LE_PIN, ADF4351_CLK_PIN, ADF4351_DATA_PIN>> adf4351(ADF4351_CE_PIN, ADF4351_LD_PIN);
+
+// Timer driven sweep engine
+ADF4351Sweeper<ADF4351PioBus<ADF4351_LE_PIN, ADF4351_CLK_PIN, ADF4351_DATA_PIN>> sweeper(adf4351);
+
+// Queued serial output, so a slow host never holds up a sweep step
+ADF4351Output<2048> output(Serial);
+
+// Serial command line
+ADF4351LineBuffer<64> input;
 
 // Sweep parameters
 uint32_t startFreq = 100000000;  // 100 MHz
 uint32_t stopFreq = 200000000;   // 200 MHz
 uint32_t stepSize = 1000000;     // 1 MHz
-uint32_t dwellTime = 100;        // 100 ms per frequency
+uint32_t dwellTime = 100;        // 100 ms per frequency (upper limit)
+uint32_t settleTime = 1;         // 1 ms held after lock is detected
+
+// Sweep plan: 16384 words (64 KB) fit e.g. 10000 steps at ~4 bytes each
+#define SWEEP_MAX_WORDS 16384
+uint32_t sweepWords[SWEEP_MAX_WORDS];
+ADF4351SweepPlan sweepPlan(sweepWords, SWEEP_MAX_WORDS);
 
 // Sweep state
 uint32_t currentFreq = 0;
+uint32_t sweepIndex = 0;     // Step number within the plan
+uint32_t sweepPosition = 0;  // Word position of the next step
 bool sweepRunning = false;
 unsigned long lastStepTime = 0;
+unsigned long lockedTime = 0;  // millis() when the step was seen locked
+bool stepLocked = false;
 
 void setup() {
   // Initialize serial communication
@@ -39,8 +68,8 @@ void setup() {
     ; // Wait for serial port to connect
   }
   
-  Serial.println("ADF4351 Frequency Sweep Example");
-  Serial.println("-------------------------------");
+  output.println("ADF4351 Frequency Sweep Example");
+  output.println("-------------------------------");
   
   // Initialize ADF4351
   adf4351.begin(REF_FREQ);
@@ -49,179 +78,305 @@ void setup() {
   adf4351.setFrequency(startFreq);
   currentFreq = startFreq;
   
-  Serial.println("ADF4351 initialized");
+  output.println("ADF4351 initialized");
   printHelp();
 }
 
 void loop() {
+  // Send queued output as the port takes it
+  output.drain();
+  
   // Process serial commands
   processSerial();
   
   // Handle frequency sweep if running
   if (sweepRunning) {
     unsigned long currentTime = millis();
+    unsigned long elapsed = currentTime - lastStepTime;
     
-    // Check if it's time to step to the next frequency
-    if (currentTime - lastStepTime >= dwellTime) {
-      // Move to next frequency
-      currentFreq += stepSize;
-      
-      // Check if we've reached the end of the sweep
-      if (currentFreq > stopFreq) {
-        currentFreq = startFreq; // Restart sweep
-        Serial.println("Sweep cycle complete, restarting");
+    // Note when the PLL reports lock; waitForLock() returns -1 until then,
+    // and always if lock detect is not wired
+    if (!stepLocked && adf4351.waitForLock(0) >= 0) {
+      stepLocked = true;
+      lockedTime = currentTime;
+    }
+    
+    // Step once settleTime has passed since lock, or after the full dwell
+    // time if lock is never seen
+    bool settled = stepLocked && currentTime - lockedTime >= settleTime;
+    if (settled || elapsed >= dwellTime) {
+      // Move to next frequency; position 0 means the plan wrapped around
+      if (sweepPosition == 0) {
+        sweepIndex = 0; // Restart sweep
+        output.println("Sweep cycle complete, restarting");
+      } else {
+        sweepIndex++;
       }
+      currentFreq = startFreq + sweepIndex * stepSize;
       
-      // Set the new frequency
-      adf4351.setFrequency(currentFreq);
+      // Stream the precompiled register words of this step
+      sweepPosition = adf4351.sweepStep(sweepPlan, sweepPosition);
       
       // Print current frequency (only every 10 steps to avoid flooding serial)
       if ((currentFreq - startFreq) % (stepSize * 10) == 0) {
-        Serial.print("Frequency: ");
-        Serial.print(currentFreq / 1000000.0, 3);
-        Serial.println(" MHz");
+        output.print("Frequency: ");
+        output.print(currentFreq / 1000000.0, 3);
+        output.println(" MHz");
       }
       
       // Update last step time
       lastStepTime = currentTime;
+      stepLocked = false;
     }
   }
 }
 
 void processSerial() {
-  if (Serial.available()) {
-    String command = Serial.readStringUntil('\n');
-    command.trim();
-    command.toLowerCase();
+  while (Serial.available()) {
+    uint8_t result = input.feed(Serial.read());
+    if (result == ADF4351_LINE_READY) {
+      processCommand(input.line());
+    } else if (result == ADF4351_LINE_OVERFLOW) {
+      output.println("Error: Command too long");
+    }
+  }
+}
+
+// "start" starts the sweep, "start 100" sets the start frequency in MHz
+void cmdStart(const ADF4351CommandArgs& args) {
+  if (args.present) {
+    uint32_t freq = args.value;
     
-    if (command == "start") {
-      // Start the sweep
-      sweepRunning = true;
+    if (freq >= 35000000 && freq < stopFreq) {
+      startFreq = freq;
       currentFreq = startFreq;
-      adf4351.setFrequency(currentFreq);
-      lastStepTime = millis();
-      Serial.println("Sweep started");
-      
-      // Print sweep parameters
-      printSweepParams();
-    }
-    else if (command == "stop") {
-      // Stop the sweep
-      sweepRunning = false;
-      Serial.println("Sweep stopped");
+      output.print("Start frequency set to: ");
+      output.print(startFreq / 1000000.0, 3);
+      output.println(" MHz");
+    } else {
+      output.println("Error: Invalid start frequency");
     }
-    else if (command.startsWith("start ")) {
-      // Set start frequency: "start 100"
-      String freqStr = command.substring(6);
-      uint32_t freq = (uint32_t)(freqStr.toFloat() * 1000000);
-      
-      if (freq >= 35000000 && freq <= 4400000000UL && freq < stopFreq) {
-        startFreq = freq;
-        currentFreq = startFreq;
-        Serial.print("Start frequency set to: ");
-        Serial.print(startFreq / 1000000.0, 3);
-        Serial.println(" MHz");
-      } else {
-        Serial.println("Error: Invalid start frequency");
-      }
-    }
-    else if (command.startsWith("stop ")) {
-      // Set stop frequency: "stop 200"
-      String freqStr = command.substring(5);
-      uint32_t freq = (uint32_t)(freqStr.toFloat() * 1000000);
-      
-      if (freq >= 35000000 && freq <= 4400000000UL && freq > startFreq) {
-        stopFreq = freq;
-        Serial.print("Stop frequency set to: ");
-        Serial.print(stopFreq / 1000000.0, 3);
-        Serial.println(" MHz");
-      } else {
-        Serial.println("Error: Invalid stop frequency");
-      }
-    }
-    else if (command.startsWith("step ")) {
-      // Set step size: "step 1"
-      String stepStr = command.substring(5);
-      uint32_t step = (uint32_t)(stepStr.toFloat() * 1000000);
-      
-      if (step > 0 && step <= (stopFreq - startFreq)) {
-        stepSize = step;
-        Serial.print("Step size set to: ");
-        Serial.print(stepSize / 1000000.0, 3);
-        Serial.println(" MHz");
-      } else {
-        Serial.println("Error: Invalid step size");
-      }
-    }
-    else if (command.startsWith("dwell ")) {
-      // Set dwell time: "dwell 100"
-      String dwellStr = command.substring(6);
-      uint32_t dwell = dwellStr.toInt();
-      
-      if (dwell > 0 && dwell <= 10000) {
-        dwellTime = dwell;
-        Serial.print("Dwell time set to: ");
-        Serial.print(dwellTime);
-        Serial.println(" ms");
-      } else {
-        Serial.println("Error: Invalid dwell time (1-10000 ms)");
-      }
-    }
-    else if (command == "params") {
-      // Print sweep parameters
-      printSweepParams();
-    }
-    else if (command == "help") {
-      // Print help
-      printHelp();
-    }
-    else {
-      // Unknown command
-      Serial.println("Unknown command. Type 'help' for available commands.");
+    return;
+  }
+  
+  sweeper.stop();
+  if (!compileSweep()) {
+    return;
+  }
+  
+  // Start the sweep
+  sweepRunning = true;
+  sweepIndex = 0;
+  currentFreq = startFreq;
+  sweepPosition = adf4351.sweepStep(sweepPlan, 0);
+  lastStepTime = millis();
+  stepLocked = false;
+  output.println("Sweep started");
+  
+  // Print sweep parameters
+  printSweepParams();
+}
+
+// "stop" stops the sweep, "stop 200" sets the stop frequency in MHz
+void cmdStop(const ADF4351CommandArgs& args) {
+  if (args.present) {
+    uint32_t freq = args.value;
+    
+    if (freq >= 35000000 && freq > startFreq) {
+      stopFreq = freq;
+      output.print("Stop frequency set to: ");
+      output.print(stopFreq / 1000000.0, 3);
+      output.println(" MHz");
+    } else {
+      output.println("Error: Invalid stop frequency");
     }
+    return;
+  }
+  
+  // Stop the sweep
+  bool timed = sweeper.isRunning();
+  sweeper.stop();
+  sweepRunning = false;
+  output.println("Sweep stopped");
+  if (timed) {
+    printSweepStats();
+  }
+}
+
+// Timer driven sweep: "fast 50" steps every 50 us
+void cmdFast(const ADF4351CommandArgs& args) {
+  uint32_t dwell = args.value;
+  sweepRunning = false;
+  sweeper.stop();
+  if (!compileSweep()) {
+    return;
+  }
+  
+  if (sweeper.start(sweepPlan, dwell)) {
+    output.print("Fast sweep started, ");
+    output.print(dwell);
+    output.println(" us per step");
+    printSweepParams();
+  } else {
+    output.print("Error: Invalid dwell time (minimum ");
+    output.print(ADF4351_SWEEP_MIN_DWELL);
+    output.println(" us)");
+  }
+}
+
+// Set step size: "step 1"
+void cmdStep(const ADF4351CommandArgs& args) {
+  uint32_t step = args.value;
+  
+  if (step > 0 && step <= (stopFreq - startFreq)) {
+    stepSize = step;
+    output.print("Step size set to: ");
+    output.print(stepSize / 1000000.0, 3);
+    output.println(" MHz");
+  } else {
+    output.println("Error: Invalid step size");
+  }
+}
+
+// Set dwell time: "dwell 100"
+void cmdDwell(const ADF4351CommandArgs& args) {
+  uint32_t dwell = args.value;
+  
+  if (dwell > 0 && dwell <= 10000) {
+    dwellTime = dwell;
+    output.print("Dwell time set to: ");
+    output.print(dwellTime);
+    output.println(" ms");
+  } else {
+    output.println("Error: Invalid dwell time (1-10000 ms)");
+  }
+}
+
+// Print sweep parameters
+void cmdParams(const ADF4351CommandArgs& args) {
+  printSweepParams();
+}
+
+// Print help
+void cmdHelp(const ADF4351CommandArgs& args) {
+  printHelp();
+}
+
+// Command table, hashed at compile time
+constexpr ADF4351CommandSpec COMMAND_SPECS[] = {
+  {"start", ADF4351_ARG_MHZ | ADF4351_ARG_OPTIONAL, cmdStart},
+  {"stop", ADF4351_ARG_MHZ | ADF4351_ARG_OPTIONAL, cmdStop},
+  {"fast", ADF4351_ARG_UINT, cmdFast},
+  {"step", ADF4351_ARG_MHZ, cmdStep},
+  {"dwell", ADF4351_ARG_UINT, cmdDwell},
+  {"params", ADF4351_ARG_NONE, cmdParams},
+  {"help", ADF4351_ARG_NONE, cmdHelp}
+};
+constexpr ADF4351CommandTable commands(COMMAND_SPECS);
+static_assert(commands.isPerfect(), "Command names must be unique");
+
+void processCommand(char* line) {
+  uint8_t result = commands.execute(line);
+  if (result == ADF4351_PARSE_UNKNOWN) {
+    output.println("Unknown command. Type 'help' for available commands.");
+  } else if (result == ADF4351_PARSE_BAD_ARGUMENT) {
+    output.println("Error: Invalid argument. Type 'help' for available commands.");
+  }
+}
+
+// Solve the sweep parameters into the plan
+bool compileSweep() {
+  // A MOD matching the step size keeps most steps down to the R0 word
+  if (!adf4351.compileSweep(sweepPlan, startFreq, stopFreq, stepSize, stepSize)) {
+    output.println("Error: Sweep does not fit the plan buffer");
+    return false;
+  }
+  return true;
+}
+
+void printSweepStats() {
+  ADF4351SweepStats stats = sweeper.getStats();
+  
+  output.print("Steps: ");
+  output.print(stats.steps);
+  output.print(" (");
+  output.print(stats.cycles);
+  output.println(" complete cycles)");
+  
+  if (stats.steps > 1) {
+    output.print("Lateness min/mean/max: ");
+    output.print(stats.minLate);
+    output.print(" / ");
+    output.print((uint32_t)(stats.totalLate / (stats.steps - 1)));
+    output.print(" / ");
+    output.print(stats.maxLate);
+    output.println(" us");
+    
+    output.print("Jitter: ");
+    output.print(stats.maxLate - stats.minLate);
+    output.println(" us");
+  }
+  
+  output.print("Longest step write: ");
+  output.print(stats.maxStepTime);
+  output.println(" us");
+  
+  if (stats.overrun) {
+    output.println("Stopped early: steps fell a whole dwell behind");
   }
 }
 
 void printSweepParams() {
-  Serial.println("\nSweep Parameters:");
-  Serial.println("-----------------");
-  Serial.print("Start Frequency: ");
-  Serial.print(startFreq / 1000000.0, 3);
-  Serial.println(" MHz");
+  output.println("\nSweep Parameters:");
+  output.println("-----------------");
+  output.print("Start Frequency: ");
+  output.print(startFreq / 1000000.0, 3);
+  output.println(" MHz");
+  
+  output.print("Stop Frequency: ");
+  output.print(stopFreq / 1000000.0, 3);
+  output.println(" MHz");
+  
+  output.print("Step Size: ");
+  output.print(stepSize / 1000000.0, 3);
+  output.println(" MHz");
   
-  Serial.print("Stop Frequency: ");
-  Serial.print(stopFreq / 1000000.0, 3);
-  Serial.println(" MHz");
+  output.print("Dwell Time: ");
+  output.print(dwellTime);
+  output.println(" ms");
   
-  Serial.print("Step Size: ");
-  Serial.print(stepSize / 1000000.0, 3);
-  Serial.println(" MHz");
+  output.print("Settle Time: ");
+  output.print(settleTime);
+  output.println(" ms after lock");
   
-  Serial.print("Dwell Time: ");
-  Serial.print(dwellTime);
-  Serial.println(" ms");
+  output.print("Total Steps: ");
+  output.println((stopFreq - startFreq) / stepSize + 1);
   
-  Serial.print("Total Steps: ");
-  Serial.println((stopFreq - startFreq) / stepSize + 1);
+  output.print("Plan Memory: ");
+  output.print(sweepPlan.getBytes());
+  output.print(" bytes (");
+  output.print(sweepPlan.getBytesPerStep100() / 100.0, 2);
+  output.println(" bytes/step)");
   
-  Serial.print("Sweep Time: ");
-  Serial.print(((stopFreq - startFreq) / stepSize + 1) * dwellTime / 1000.0, 2);
-  Serial.println(" seconds");
+  output.print("Sweep Time (max): ");
+  output.print(((stopFreq - startFreq) / stepSize + 1) * dwellTime / 1000.0, 2);
+  output.println(" seconds");
   
-  Serial.println();
+  output.println();
 }
 
 void printHelp() {
-  Serial.println("\nAvailable Commands:");
-  Serial.println("------------------");
-  Serial.println("start       - Start frequency sweep");
-  Serial.println("stop        - Stop frequency sweep");
-  Serial.println("start <MHz> - Set start frequency in MHz");
-  Serial.println("stop <MHz>  - Set stop frequency in MHz");
-  Serial.println("step <MHz>  - Set step size in MHz");
-  Serial.println("dwell <ms>  - Set dwell time in milliseconds");
-  Serial.println("params      - Display current sweep parameters");
-  Serial.println("help        - Display this help message");
-  Serial.println("\nExample: start 100");
-  Serial.println();
+  output.println("\nAvailable Commands:");
+  output.println("------------------");
+  output.println("start       - Start frequency sweep");
+  output.println("fast <us>   - Start timer driven sweep with a fixed dwell in microseconds");
+  output.println("stop        - Stop frequency sweep (prints timing after a fast sweep)");
+  output.println("start <MHz> - Set start frequency in MHz");
+  output.println("stop <MHz>  - Set stop frequency in MHz");
+  output.println("step <MHz>  - Set step size in MHz");
+  output.println("dwell <ms>  - Set maximum dwell time in milliseconds");
+  output.println("params      - Display current sweep parameters");
+  output.println("help        - Display this help message");
+  output.println("\nExample: start 100");
+  output.println();
 }
@@ -9,6 +9,8 @@
  */
 
 #include "ADF4351.h"
+#include "ADF4351_Output.h"
+#include "ADF4351_Commands.h"
 
 // Pin definitions
 #define ADF4351_LE_PIN   5  // Latch Enable Pin
@@ -22,6 +24,9 @@ const uint32_t REF_FREQ = 25000000; // 25 MHz reference
 // Create ADF4351 instance
 ADF4351 adf4351(ADF4351_LE_PIN, ADF4351_CLK_PIN, ADF4351_DATA_PIN, ADF4351_CE_PIN);
 
+// Queued serial output, so a slow host never holds up a retune
+ADF4351Output<2048> output(Serial);
+
 // Ham band presets (in Hz)
 struct BandPreset {
   const char* name;
@@ -51,6 +56,9 @@ const BandPreset hamBands[] = {
 const int NUM_BANDS = sizeof(hamBands) / sizeof(hamBands[0]);
 int currentBandIndex = 11; // Default to 2m band
 
+// Serial command line
+ADF4351LineBuffer<64> input;
+
 // Tuning step sizes (in Hz)
 const uint32_t stepSizes[] = {10, 100, 1000, 10000, 100000, 1000000};
 const int NUM_STEPS = sizeof(stepSizes) / sizeof(stepSizes[0]);
@@ -66,111 +74,145 @@ void setup() {
     ; // Wait for serial port to connect
   }
   
-  Serial.println("ADF4351 Ham Band Signal Generator");
-  Serial.println("--------------------------------");
+  output.println("ADF4351 Ham Band Signal Generator");
+  output.println("--------------------------------");
   
   // Initialize ADF4351
   adf4351.begin(REF_FREQ);
   
+  // Plan MOD around the tuning step so steps only rewrite R0
+  adf4351.setChannelResolution(stepSizes[currentStepIndex]);
+  
   // Set initial band
   setBand(currentBandIndex);
   
-  Serial.println("ADF4351 initialized");
+  output.println("ADF4351 initialized");
   printHelp();
 }
 
 void loop() {
+  // Send queued output as the port takes it
+  output.drain();
+  
   // Process serial commands
-  if (Serial.available()) {
-    String command = Serial.readStringUntil('\n');
-    command.trim();
-    command.toLowerCase();
-    
-    processCommand(command);
+  while (Serial.available()) {
+    uint8_t result = input.feed(Serial.read());
+    if (result == ADF4351_LINE_READY) {
+      processCommand(input.line());
+    } else if (result == ADF4351_LINE_OVERFLOW) {
+      output.println("Error: Command too long");
+    }
   }
 }
 
-void processCommand(String command) {
-  if (command == "next") {
-    // Next band
-    currentBandIndex = (currentBandIndex + 1) % NUM_BANDS;
-    setBand(currentBandIndex);
-  }
-  else if (command == "prev") {
-    // Previous band
-    currentBandIndex = (currentBandIndex - 1 + NUM_BANDS) % NUM_BANDS;
-    setBand(currentBandIndex);
-  }
-  else if (command == "up") {
-    // Increase frequency by current step size
-    setFrequency(currentFrequency + stepSizes[currentStepIndex]);
-  }
-  else if (command == "down") {
-    // Decrease frequency by current step size
-    setFrequency(currentFrequency - stepSizes[currentStepIndex]);
-  }
-  else if (command == "step") {
-    // Cycle through step sizes
-    currentStepIndex = (currentStepIndex + 1) % NUM_STEPS;
-    Serial.print("Step size: ");
-    printFrequency(stepSizes[currentStepIndex]);
-    Serial.println();
-  }
-  else if (command.startsWith("band ")) {
-    // Set band by name: "band 2m"
-    String bandName = command.substring(5);
-    
-    for (int i = 0; i < NUM_BANDS; i++) {
-      if (bandName == hamBands[i].name) {
-        currentBandIndex = i;
-        setBand(currentBandIndex);
-        return;
-      }
-    }
-    
-    Serial.println("Error: Unknown band name");
-    printBands();
-  }
-  else if (command.startsWith("freq ")) {
-    // Set frequency directly: "freq 145.500"
-    String freqStr = command.substring(5);
-    float freqMHz = freqStr.toFloat();
-    uint32_t frequency = (uint32_t)(freqMHz * 1000000);
-    
-    if (frequency >= 35000000 && frequency <= 4400000000UL) {
-      setFrequency(frequency);
-    } else {
-      Serial.println("Error: Frequency out of range (35 MHz to 4.4 GHz)");
+// Next band
+void cmdNext(const ADF4351CommandArgs& args) {
+  currentBandIndex = (currentBandIndex + 1) % NUM_BANDS;
+  setBand(currentBandIndex);
+}
+
+// Previous band
+void cmdPrev(const ADF4351CommandArgs& args) {
+  currentBandIndex = (currentBandIndex - 1 + NUM_BANDS) % NUM_BANDS;
+  setBand(currentBandIndex);
+}
+
+// Increase frequency by current step size
+void cmdUp(const ADF4351CommandArgs& args) {
+  setFrequency(currentFrequency + stepSizes[currentStepIndex]);
+}
+
+// Decrease frequency by current step size
+void cmdDown(const ADF4351CommandArgs& args) {
+  setFrequency(currentFrequency - stepSizes[currentStepIndex]);
+}
+
+// Cycle through step sizes
+void cmdStep(const ADF4351CommandArgs& args) {
+  currentStepIndex = (currentStepIndex + 1) % NUM_STEPS;
+  adf4351.setChannelResolution(stepSizes[currentStepIndex]);
+  output.print("Step size: ");
+  printFrequency(stepSizes[currentStepIndex]);
+  output.println();
+}
+
+// Set band by name: "band 2m"
+void cmdBand(const ADF4351CommandArgs& args) {
+  for (int i = 0; i < NUM_BANDS; i++) {
+    if (strcmp(args.text, hamBands[i].name) == 0) {
+      currentBandIndex = i;
+      setBand(currentBandIndex);
+      return;
     }
   }
-  else if (command == "power") {
-    // Cycle through power levels
-    static uint8_t powerLevel = 3;
-    powerLevel = (powerLevel + 1) % 4;
-    
-    adf4351.setPowerLevel(powerLevel);
-    
-    Serial.print("Power level: ");
-    Serial.print(powerLevel);
-    Serial.print(" (");
-    Serial.print(-4 + (powerLevel * 3));
-    Serial.println(" dBm)");
-  }
-  else if (command == "bands") {
-    // List all bands
-    printBands();
-  }
-  else if (command == "status") {
-    // Print current status
-    printStatus();
-  }
-  else if (command == "help") {
-    // Print help
-    printHelp();
+  
+  output.println("Error: Unknown band name");
+  printBands();
+}
+
+// Set frequency directly: "freq 145.500"
+void cmdFreq(const ADF4351CommandArgs& args) {
+  uint32_t frequency = args.value;
+  
+  if (frequency >= 35000000) {
+    setFrequency(frequency);
+  } else {
+    output.println("Error: Frequency out of range (35 MHz to 4.4 GHz)");
   }
-  else {
-    // Unknown command
-    Serial.println("Unknown command. Type 'help' for available commands.");
+}
+
+// Cycle through power levels
+void cmdPower(const ADF4351CommandArgs& args) {
+  static uint8_t powerLevel = 3;
+  powerLevel = (powerLevel + 1) % 4;
+  
+  adf4351.setPowerLevel(powerLevel);
+  
+  output.print("Power level: ");
+  output.print(powerLevel);
+  output.print(" (");
+  output.print(-4 + (powerLevel * 3));
+  output.println(" dBm)");
+}
+
+// List all bands
+void cmdBands(const ADF4351CommandArgs& args) {
+  printBands();
+}
+
+// Print current status
+void cmdStatus(const ADF4351CommandArgs& args) {
+  printStatus();
+}
+
+// Print help
+void cmdHelp(const ADF4351CommandArgs& args) {
+  printHelp();
+}
+
+// Command table, hashed at compile time
+constexpr ADF4351CommandSpec COMMAND_SPECS[] = {
+  {"next", ADF4351_ARG_NONE, cmdNext},
+  {"prev", ADF4351_ARG_NONE, cmdPrev},
+  {"up", ADF4351_ARG_NONE, cmdUp},
+  {"down", ADF4351_ARG_NONE, cmdDown},
+  {"step", ADF4351_ARG_NONE, cmdStep},
+  {"band", ADF4351_ARG_TEXT, cmdBand},
+  {"freq", ADF4351_ARG_MHZ, cmdFreq},
+  {"power", ADF4351_ARG_NONE, cmdPower},
+  {"bands", ADF4351_ARG_NONE, cmdBands},
+  {"status", ADF4351_ARG_NONE, cmdStatus},
+  {"help", ADF4351_ARG_NONE, cmdHelp}
+};
+constexpr ADF4351CommandTable commands(COMMAND_SPECS);
+static_assert(commands.isPerfect(), "Command names must be unique");
+
+void processCommand(char* line) {
+  uint8_t result = commands.execute(line);
+  if (result == ADF4351_PARSE_UNKNOWN) {
+    output.println("Unknown command. Type 'help' for available commands.");
+  } else if (result == ADF4351_PARSE_BAD_ARGUMENT) {
+    output.println("Error: Invalid argument. Type 'help' for available commands.");
   }
 }
 
@@ -178,99 +220,86 @@ void setBand(int bandIndex) {
   // Set frequency to the selected band
   setFrequency(hamBands[bandIndex].frequency);
   
-  Serial.print("Band: ");
-  Serial.print(hamBands[bandIndex].name);
-  Serial.print(" (");
+  output.print("Band: ");
+  output.print(hamBands[bandIndex].name);
+  output.print(" (");
   printFrequency(hamBands[bandIndex].frequency);
-  Serial.println(")");
+  output.println(")");
 }
 
 void setFrequency(uint32_t frequency) {
-  // Check if frequency is within range
+  // Check if frequency is within range (a uint32_t stays below 4.4 GHz)
   if (frequency < 35000000) {
     frequency = 35000000;
-    Serial.println("Frequency limited to 35 MHz minimum");
-  } else if (frequency > 4400000000UL) {
-    frequency = 4400000000UL;
-    Serial.println("Frequency limited to 4.4 GHz maximum");
+    output.println("Frequency limited to 35 MHz minimum");
   }
   
-  // Set the frequency
-  adf4351.setFrequency(frequency);
+  // Set the frequency (R0 only when the step allows it)
+  adf4351.retune(frequency);
   currentFrequency = frequency;
   
   // Print the frequency
-  Serial.print("Frequency: ");
+  output.print("Frequency: ");
   printFrequency(frequency);
-  Serial.println();
+  output.println();
 }
 
 void printFrequency(uint32_t frequency) {
-  // Print frequency in appropriate units
-  if (frequency < 1000000) {
-    // Less than 1 MHz, print in kHz
-    Serial.print(frequency / 1000.0, 3);
-    Serial.print(" kHz");
-  } else if (frequency < 1000000000UL) {
-    // Less than 1 GHz, print in MHz
-    Serial.print(frequency / 1000000.0, 6);
-    Serial.print(" MHz");
-  } else {
-    // 1 GHz or more, print in GHz
-    Serial.print(frequency / 1000000000.0, 6);
-    Serial.print(" GHz");
-  }
+  // Print frequency in appropriate units (kHz, MHz or GHz), exact to 1 Hz
+  char text[ADF4351_FREQUENCY_TEXT];
+  ADF4351Text::formatFrequency(text, sizeof(text), frequency);
+  output.print(text);
 }
 
 void printBands() {
-  Serial.println("\nAvailable Ham Bands:");
-  Serial.println("-------------------");
+  output.println("\nAvailable Ham Bands:");
+  output.println("-------------------");
   
   for (int i = 0; i < NUM_BANDS; i++) {
-    Serial.print(hamBands[i].name);
-    Serial.print(": ");
+    output.print(hamBands[i].name);
+    output.print(": ");
     printFrequency(hamBands[i].frequency);
-    Serial.println();
+    output.println();
   }
   
-  Serial.println();
+  output.println();
 }
 
 void printStatus() {
-  Serial.println("\nCurrent Status:");
-  Serial.println("--------------");
+  output.println("\nCurrent Status:");
+  output.println("--------------");
   
-  Serial.print("Band: ");
-  Serial.println(hamBands[currentBandIndex].name);
+  output.print("Band: ");
+  output.println(hamBands[currentBandIndex].name);
   
-  Serial.print("Frequency: ");
+  output.print("Frequency: ");
   printFrequency(currentFrequency);
-  Serial.println();
+  output.println();
   
-  Serial.print("Step Size: ");
+  output.print("Step Size: ");
   printFrequency(stepSizes[currentStepIndex]);
-  Serial.println();
+  output.println();
   
-  Serial.print("PLL Lock: ");
-  Serial.println(adf4351.isLocked() ? "Locked" : "Unlocked");
+  output.print("PLL Lock: ");
+  output.println(adf4351.isLocked() ? "Locked" : "Unlocked");
   
-  Serial.println();
+  output.println();
 }
 
 void printHelp() {
-  Serial.println("\nAvailable Commands:");
-  Serial.println("------------------");
-  Serial.println("next        - Go to next ham band");
-  Serial.println("prev        - Go to previous ham band");
-  Serial.println("up          - Increase frequency by current step size");
-  Serial.println("down        - Decrease frequency by current step size");
-  Serial.println("step        - Cycle through step sizes");
-  Serial.println("band <name> - Set band by name (e.g., 'band 2m')");
-  Serial.println("freq <MHz>  - Set frequency directly in MHz");
-  Serial.println("power       - Cycle through power levels");
-  Serial.println("bands       - List all available ham bands");
-  Serial.println("status      - Display current status");
-  Serial.println("help        - Display this help message");
-  Serial.println("\nExample: freq 145.500");
-  Serial.println();
+  output.println("\nAvailable Commands:");
+  output.println("------------------");
+  output.println("next        - Go to next ham band");
+  output.println("prev        - Go to previous ham band");
+  output.println("up          - Increase frequency by current step size");
+  output.println("down        - Decrease frequency by current step size");
+  output.println("step        - Cycle through step sizes");
+  output.println("band <name> - Set band by name (e.g., 'band 2m')");
+  output.println("freq <MHz>  - Set frequency directly in MHz");
+  output.println("power       - Cycle through power levels");
+  output.println("bands       - List all available ham bands");
+  output.println("status      - Display current status");
+  output.println("help        - Display this help message");
+  output.println("\nExample: freq 145.500");
+  output.println();
 }
@@ -9,6 +9,8 @@
  */
 
 #include "ADF4351.h"
+#include "ADF4351_Output.h"
+#include "ADF4351_Commands.h"
 
 // Pin definitions
 #define ADF4351_LE_PIN   5  // Latch Enable Pin
@@ -22,6 +24,9 @@ const uint32_t REF_FREQ = 25000000; // 25 MHz reference
 // Create ADF4351 instance
 ADF4351 adf4351(ADF4351_LE_PIN, ADF4351_CLK_PIN, ADF4351_DATA_PIN, ADF4351_CE_PIN);
 
+// Queued serial output, so a slow host never holds up a retune
+ADF4351Output<2048> output(Serial);
+
 // SDR parameters
 uint32_t targetFrequency = 145000000;  // Target frequency (145 MHz)
 uint32_t ifOffset = 10700000;          // IF offset (10.7 MHz)
@@ -54,6 +59,9 @@ const SdrBand sdrBands[] = {
 const int NUM_BANDS = sizeof(sdrBands) / sizeof(sdrBands[0]);
 int currentBandIndex = 6; // Default to 2m Ham
 
+// Serial command line
+ADF4351LineBuffer<64> input;
+
 // Tuning step sizes (in Hz)
 const uint32_t stepSizes[] = {100, 1000, 5000, 12500, 25000, 100000, 1000000};
 const int NUM_STEPS = sizeof(stepSizes) / sizeof(stepSizes[0]);
@@ -66,8 +74,8 @@ void setup() {
     ; // Wait for serial port to connect
   }
   
-  Serial.println("ADF4351 SDR Local Oscillator");
-  Serial.println("---------------------------");
+  output.println("ADF4351 SDR Local Oscillator");
+  output.println("---------------------------");
   
   // Initialize ADF4351
   adf4351.begin(REF_FREQ);
@@ -75,108 +83,140 @@ void setup() {
   // Set low spur mode for better SDR performance
   adf4351.setLowNoiseMode(false);
   
+  // Plan MOD around the tuning step so steps only rewrite R0
+  adf4351.setChannelResolution(stepSizes[currentStepIndex]);
+  
   // Set initial band
   setBand(currentBandIndex);
   
-  Serial.println("ADF4351 initialized");
+  output.println("ADF4351 initialized");
   printHelp();
 }
 
 void loop() {
+  // Send queued output as the port takes it
+  output.drain();
+  
   // Process serial commands
-  if (Serial.available()) {
-    String command = Serial.readStringUntil('\n');
-    command.trim();
-    command.toLowerCase();
-    
-    processCommand(command);
+  while (Serial.available()) {
+    uint8_t result = input.feed(Serial.read());
+    if (result == ADF4351_LINE_READY) {
+      processCommand(input.line());
+    } else if (result == ADF4351_LINE_OVERFLOW) {
+      output.println("Error: Command too long");
+    }
   }
 }
 
-void processCommand(String command) {
-  if (command == "next") {
-    // Next band
-    currentBandIndex = (currentBandIndex + 1) % NUM_BANDS;
-    setBand(currentBandIndex);
-  }
-  else if (command == "prev") {
-    // Previous band
-    currentBandIndex = (currentBandIndex - 1 + NUM_BANDS) % NUM_BANDS;
+// Next band
+void cmdNext(const ADF4351CommandArgs& args) {
+  currentBandIndex = (currentBandIndex + 1) % NUM_BANDS;
+  setBand(currentBandIndex);
+}
+
+// Previous band
+void cmdPrev(const ADF4351CommandArgs& args) {
+  currentBandIndex = (currentBandIndex - 1 + NUM_BANDS) % NUM_BANDS;
+  setBand(currentBandIndex);
+}
+
+// Increase frequency by current step size
+void cmdUp(const ADF4351CommandArgs& args) {
+  setTargetFrequency(targetFrequency + stepSizes[currentStepIndex]);
+}
+
+// Decrease frequency by current step size
+void cmdDown(const ADF4351CommandArgs& args) {
+  setTargetFrequency(targetFrequency - stepSizes[currentStepIndex]);
+}
+
+// Cycle through step sizes
+void cmdStep(const ADF4351CommandArgs& args) {
+  currentStepIndex = (currentStepIndex + 1) % NUM_STEPS;
+  adf4351.setChannelResolution(stepSizes[currentStepIndex]);
+  output.print("Step size: ");
+  printFrequency(stepSizes[currentStepIndex]);
+  output.println();
+}
+
+// Set band by index: "band 6"
+void cmdBand(const ADF4351CommandArgs& args) {
+  if (args.value < NUM_BANDS) {
+    currentBandIndex = args.value;
     setBand(currentBandIndex);
-  }
-  else if (command == "up") {
-    // Increase frequency by current step size
-    setTargetFrequency(targetFrequency + stepSizes[currentStepIndex]);
-  }
-  else if (command == "down") {
-    // Decrease frequency by current step size
-    setTargetFrequency(targetFrequency - stepSizes[currentStepIndex]);
-  }
-  else if (command == "step") {
-    // Cycle through step sizes
-    currentStepIndex = (currentStepIndex + 1) % NUM_STEPS;
-    Serial.print("Step size: ");
-    printFrequency(stepSizes[currentStepIndex]);
-    Serial.println();
-  }
-  else if (command.startsWith("band ")) {
-    // Set band by index: "band 6"
-    int bandIndex = command.substring(5).toInt();
-    
-    if (bandIndex >= 0 && bandIndex < NUM_BANDS) {
-      currentBandIndex = bandIndex;
-      setBand(currentBandIndex);
-    } else {
-      Serial.println("Error: Invalid band index");
-      printBands();
-    }
-  }
-  else if (command.startsWith("freq ")) {
-    // Set target frequency directly: "freq 145.500"
-    String freqStr = command.substring(5);
-    float freqMHz = freqStr.toFloat();
-    uint32_t frequency = (uint32_t)(freqMHz * 1000000);
-    
-    setTargetFrequency(frequency);
-  }
-  else if (command.startsWith("if ")) {
-    // Set IF offset: "if 10.7"
-    String ifStr = command.substring(3);
-    float ifMHz = ifStr.toFloat();
-    ifOffset = (uint32_t)(ifMHz * 1000000);
-    
-    Serial.print("IF Offset: ");
-    printFrequency(ifOffset);
-    Serial.println();
-    
-    // Update LO frequency with new IF offset
-    updateLoFrequency();
-  }
-  else if (command == "injection") {
-    // Toggle high/low side injection
-    highSideInjection = !highSideInjection;
-    
-    Serial.print("Injection: ");
-    Serial.println(highSideInjection ? "High Side" : "Low Side");
-    
-    // Update LO frequency with new injection setting
-    updateLoFrequency();
-  }
-  else if (command == "bands") {
-    // List all bands
+  } else {
+    output.println("Error: Invalid band index");
     printBands();
   }
-  else if (command == "status") {
-    // Print current status
-    printStatus();
-  }
-  else if (command == "help") {
-    // Print help
-    printHelp();
-  }
-  else {
-    // Unknown command
-    Serial.println("Unknown command. Type 'help' for available commands.");
+}
+
+// Set target frequency directly: "freq 145.500"
+void cmdFreq(const ADF4351CommandArgs& args) {
+  setTargetFrequency(args.value);
+}
+
+// Set IF offset: "if 10.7"
+void cmdIf(const ADF4351CommandArgs& args) {
+  ifOffset = args.value;
+  
+  output.print("IF Offset: ");
+  printFrequency(ifOffset);
+  output.println();
+  
+  // Update LO frequency with new IF offset
+  updateLoFrequency();
+}
+
+// Toggle high/low side injection
+void cmdInjection(const ADF4351CommandArgs& args) {
+  highSideInjection = !highSideInjection;
+  
+  output.print("Injection: ");
+  output.println(highSideInjection ? "High Side" : "Low Side");
+  
+  // Update LO frequency with new injection setting
+  updateLoFrequency();
+}
+
+// List all bands
+void cmdBands(const ADF4351CommandArgs& args) {
+  printBands();
+}
+
+// Print current status
+void cmdStatus(const ADF4351CommandArgs& args) {
+  printStatus();
+}
+
+// Print help
+void cmdHelp(const ADF4351CommandArgs& args) {
+  printHelp();
+}
+
+// Command table, hashed at compile time
+constexpr ADF4351CommandSpec COMMAND_SPECS[] = {
+  {"next", ADF4351_ARG_NONE, cmdNext},
+  {"prev", ADF4351_ARG_NONE, cmdPrev},
+  {"up", ADF4351_ARG_NONE, cmdUp},
+  {"down", ADF4351_ARG_NONE, cmdDown},
+  {"step", ADF4351_ARG_NONE, cmdStep},
+  {"band", ADF4351_ARG_UINT, cmdBand},
+  {"freq", ADF4351_ARG_MHZ, cmdFreq},
+  {"if", ADF4351_ARG_MHZ, cmdIf},
+  {"injection", ADF4351_ARG_NONE, cmdInjection},
+  {"bands", ADF4351_ARG_NONE, cmdBands},
+  {"status", ADF4351_ARG_NONE, cmdStatus},
+  {"help", ADF4351_ARG_NONE, cmdHelp}
+};
+constexpr ADF4351CommandTable commands(COMMAND_SPECS);
+static_assert(commands.isPerfect(), "Command names must be unique");
+
+void processCommand(char* line) {
+  uint8_t result = commands.execute(line);
+  if (result == ADF4351_PARSE_UNKNOWN) {
+    output.println("Unknown command. Type 'help' for available commands.");
+  } else if (result == ADF4351_PARSE_BAD_ARGUMENT) {
+    output.println("Error: Invalid argument. Type 'help' for available commands.");
   }
 }
 
@@ -185,23 +225,24 @@ void setBand(int bandIndex) {
   uint32_t midFreq = (sdrBands[bandIndex].startFreq + sdrBands[bandIndex].endFreq) / 2;
   setTargetFrequency(midFreq);
   
-  Serial.print("Band: ");
-  Serial.print(sdrBands[bandIndex].name);
-  Serial.print(" (");
+  output.print("Band: ");
+  output.print(sdrBands[bandIndex].name);
+  output.print(" (");
   printFrequency(sdrBands[bandIndex].startFreq);
-  Serial.print(" - ");
+  output.print(" - ");
   printFrequency(sdrBands[bandIndex].endFreq);
-  Serial.println(")");
+  output.println(")");
 }
 
 void setTargetFrequency(uint32_t frequency) {
   // Check if frequency is within range for the ADF4351
   if (frequency < 35000000 - ifOffset) {
     frequency = 35000000 - ifOffset;
-    Serial.println("Warning: Target frequency limited due to ADF4351 range");
-  } else if (frequency > 4400000000UL - ifOffset) {
-    frequency = 4400000000UL - ifOffset;
-    Serial.println("Warning: Target frequency limited due to ADF4351 range");
+    output.println("Warning: Target frequency limited due to ADF4351 range");
+  } else if (frequency > 0xFFFFFFFFUL - ifOffset) {
+    // RF + IF must still fit the uint32_t LO frequency
+    frequency = 0xFFFFFFFFUL - ifOffset;
+    output.println("Warning: Target frequency limited due to ADF4351 range");
   }
   
   // Set the target frequency
@@ -211,9 +252,9 @@ void setTargetFrequency(uint32_t frequency) {
   updateLoFrequency();
   
   // Print the target frequency
-  Serial.print("Target Frequency: ");
+  output.print("Target Frequency: ");
   printFrequency(targetFrequency);
-  Serial.println();
+  output.println();
 }
 
 void updateLoFrequency() {
@@ -228,105 +269,95 @@ void updateLoFrequency() {
     loFrequency = targetFrequency - ifOffset;
   }
   
-  // Set the LO frequency
-  if (loFrequency >= 35000000 && loFrequency <= 4400000000UL) {
-    adf4351.setFrequency(loFrequency);
+  // Set the LO frequency (R0 only when the step allows it)
+  if (loFrequency >= 35000000) {
+    adf4351.retune(loFrequency);
     
     // Print the LO frequency
-    Serial.print("LO Frequency: ");
+    output.print("LO Frequency: ");
     printFrequency(loFrequency);
-    Serial.println();
+    output.println();
   } else {
-    Serial.println("Error: LO frequency out of range (35 MHz to 4.4 GHz)");
+    output.println("Error: LO frequency out of range (35 MHz to 4.4 GHz)");
   }
 }
 
 void printFrequency(uint32_t frequency) {
-  // Print frequency in appropriate units
-  if (frequency < 1000000) {
-    // Less than 1 MHz, print in kHz
-    Serial.print(frequency / 1000.0, 3);
-    Serial.print(" kHz");
-  } else if (frequency < 1000000000UL) {
-    // Less than 1 GHz, print in MHz
-    Serial.print(frequency / 1000000.0, 6);
-    Serial.print(" MHz");
-  } else {
-    // 1 GHz or more, print in GHz
-    Serial.print(frequency / 1000000000.0, 6);
-    Serial.print(" GHz");
-  }
+  // Print frequency in appropriate units (kHz, MHz or GHz), exact to 1 Hz
+  char text[ADF4351_FREQUENCY_TEXT];
+  ADF4351Text::formatFrequency(text, sizeof(text), frequency);
+  output.print(text);
 }
 
 void printBands() {
-  Serial.println("\nAvailable SDR Bands:");
-  Serial.println("-------------------");
+  output.println("\nAvailable SDR Bands:");
+  output.println("-------------------");
   
   for (int i = 0; i < NUM_BANDS; i++) {
-    Serial.print(i);
-    Serial.print(": ");
-    Serial.print(sdrBands[i].name);
-    Serial.print(" (");
+    output.print(i);
+    output.print(": ");
+    output.print(sdrBands[i].name);
+    output.print(" (");
     printFrequency(sdrBands[i].startFreq);
-    Serial.print(" - ");
+    output.print(" - ");
     printFrequency(sdrBands[i].endFreq);
-    Serial.println(")");
+    output.println(")");
   }
   
-  Serial.println();
+  output.println();
 }
 
 void printStatus() {
-  Serial.println("\nCurrent Status:");
-  Serial.println("--------------");
+  output.println("\nCurrent Status:");
+  output.println("--------------");
   
-  Serial.print("Band: ");
-  Serial.println(sdrBands[currentBandIndex].name);
+  output.print("Band: ");
+  output.println(sdrBands[currentBandIndex].name);
   
-  Serial.print("Target Frequency: ");
+  output.print("Target Frequency: ");
   printFrequency(targetFrequency);
-  Serial.println();
+  output.println();
   
-  Serial.print("IF Offset: ");
+  output.print("IF Offset: ");
   printFrequency(ifOffset);
-  Serial.println();
+  output.println();
   
-  Serial.print("Injection: ");
-  Serial.println(highSideInjection ? "High Side" : "Low Side");
+  output.print("Injection: ");
+  output.println(highSideInjection ? "High Side" : "Low Side");
   
   uint32_t loFrequency = highSideInjection ? 
                          targetFrequency + ifOffset : 
                          targetFrequency - ifOffset;
   
-  Serial.print("LO Frequency: ");
+  output.print("LO Frequency: ");
   printFrequency(loFrequency);
-  Serial.println();
+  output.println();
   
-  Serial.print("Step Size: ");
+  output.print("Step Size: ");
   printFrequency(stepSizes[currentStepIndex]);
-  Serial.println();
+  output.println();
   
-  Serial.print("PLL Lock: ");
-  Serial.println(adf4351.isLocked() ? "Locked" : "Unlocked");
+  output.print("PLL Lock: ");
+  output.println(adf4351.isLocked() ? "Locked" : "Unlocked");
   
-  Serial.println();
+  output.println();
 }
 
 void printHelp() {
-  Serial.println("\nAvailable Commands:");
-  Serial.println("------------------");
-  Serial.println("next        - Go to next SDR band");
-  Serial.println("prev        - Go to previous SDR band");
-  Serial.println("up          - Increase frequency by current step size");
-  Serial.println("down        - Decrease frequency by current step size");
-  Serial.println("step        - Cycle through step sizes");
-  Serial.println("band <idx>  - Set band by index number");
-  Serial.println("freq <MHz>  - Set target frequency directly in MHz");
-  Serial.println("if <MHz>    - Set IF offset in MHz");
-  Serial.println("injection   - Toggle between high/low side injection");
-  Serial.println("bands       - List all available SDR bands");
-  Serial.println("status      - Display current status");
-  Serial.println("help        - Display this help message");
-  Serial.println("\nExample: freq 145.500");
-  Serial.println();
+  output.println("\nAvailable Commands:");
+  output.println("------------------");
+  output.println("next        - Go to next SDR band");
+  output.println("prev        - Go to previous SDR band");
+  output.println("up          - Increase frequency by current step size");
+  output.println("down        - Decrease frequency by current step size");
+  output.println("step        - Cycle through step sizes");
+  output.println("band <idx>  - Set band by index number");
+  output.println("freq <MHz>  - Set target frequency directly in MHz");
+  output.println("if <MHz>    - Set IF offset in MHz");
+  output.println("injection   - Toggle between high/low side injection");
+  output.println("bands       - List all available SDR bands");
+  output.println("status      - Display current status");
+  output.println("help        - Display this help message");
+  output.println("\nExample: freq 145.500");
+  output.println();
 }
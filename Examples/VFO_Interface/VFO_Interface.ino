@@ -11,6 +11,7 @@
  */
 
 #include "ADF4351.h"
+#include "ADF4351_Text.h"
 #include <Wire.h>
 
 // Uncomment only ONE of these display options
@@ -139,7 +140,7 @@ void handleEncoder();
 void handleButtons();
 void setBand(int bandIndex);
 void setFrequency(uint32_t frequency);
-void formatFrequency(uint32_t frequency, char* buffer);
+void formatFrequency(uint32_t frequency, char* buffer, uint8_t size);
 void displayStatusLine();
 
 void setup() {
@@ -158,6 +159,9 @@ void setup() {
   // Initialize ADF4351
   adf4351.begin(REF_FREQ);
   
+  // Plan MOD around the tuning step so knob steps only rewrite R0
+  adf4351.setChannelResolution(stepSizes[currentStepIndex]);
+  
   // Set initial frequency
   adf4351.setFrequency(currentFrequency);
   
@@ -287,6 +291,7 @@ void handleButtons() {
       if (stepButtonState == LOW) {
         // Step button pressed, cycle through step sizes
         currentStepIndex = (currentStepIndex + 1) % NUM_STEPS;
+        adf4351.setChannelResolution(stepSizes[currentStepIndex]);
         updateDisplay();
       }
     }
@@ -336,22 +341,20 @@ void setBand(int bandIndex) {
 }
 
 void setFrequency(uint32_t frequency) {
-  // Check if frequency is within range
+  // Check if frequency is within range (a uint32_t stays below 4.4 GHz)
   if (frequency < 35000000) {
     frequency = 35000000;
-  } else if (frequency > 4400000000UL) {
-    frequency = 4400000000UL;
   }
   
-  // Set the frequency
-  if (adf4351.setFrequency(frequency)) {
+  // Set the frequency (R0 only when the step allows it)
+  if (adf4351.retune(frequency)) {
     currentFrequency = frequency;
   }
 }
 
 void updateDisplay() {
-  char freqBuffer[21];
-  formatFrequency(currentFrequency, freqBuffer);
+  char freqBuffer[ADF4351_FREQUENCY_TEXT];
+  formatFrequency(currentFrequency, freqBuffer, sizeof(freqBuffer));
   
 #ifdef USE_LCD_I2C
   // Update LCD display
@@ -465,16 +468,8 @@ void updateDisplay() {
 #endif
 }
 
-void formatFrequency(uint32_t frequency, char* buffer) {
-  // Format frequency with appropriate units and spacing
-  if (frequency < 1000000) {
-    // Less than 1 MHz, display in kHz
-    sprintf(buffer, "Freq: %7.3f kHz", frequency / 1000.0);
-  } else if (frequency < 1000000000UL) {
-    // Less than 1 GHz, display in MHz
-    sprintf(buffer, "Freq: %9.6f MHz", frequency / 1000000.0);
-  } else {
-    // 1 GHz or more, display in GHz
-    sprintf(buffer, "Freq: %6.6f GHz", frequency / 1000000000.0);
-  }
+void formatFrequency(uint32_t frequency, char* buffer, uint8_t size) {
+  // Format frequency with appropriate units, digits grouped in threes:
+  // "145.012 500 MHz" (at most 17 characters, fits a 20 column line)
+  ADF4351Text::formatFrequency(buffer, size, frequency, ADF4351_UNIT_AUTO, ' ');
 }
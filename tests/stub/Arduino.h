@@ -0,0 +1,58 @@
+/*
+ * Arduino.h - Minimal stand-in for the Arduino core in the host tests
+ *
+ * Provides only what the header-only helpers under test use: the fixed
+ * width types, the C string functions and a Print that formats numbers
+ * the way the Arduino core does.
+ *
+ * Created: October 2026
+ */
+
+#ifndef ADF4351_TEST_ARDUINO_H
+#define ADF4351_TEST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+class Print {
+  public:
+    virtual ~Print() {}
+
+    virtual size_t write(uint8_t c) = 0;
+
+    virtual size_t write(const uint8_t* buffer, size_t size) {
+      for (size_t i = 0; i < size; i++) {
+        write(buffer[i]);
+      }
+      return size;
+    }
+
+    size_t write(const char* text) { return write((const uint8_t*)text, strlen(text)); }
+
+    size_t print(const char* text) { return write(text); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int value) { return print((long)value); }
+    size_t print(unsigned int value) { return print((unsigned long)value); }
+    size_t print(long value) { return printFormat("%ld", value); }
+    size_t print(unsigned long value) { return printFormat("%lu", value); }
+
+    size_t println() { return write((const uint8_t*)"\r\n", 2); }
+
+    template <class T>
+    size_t println(T value) {
+      size_t n = print(value);
+      return n + println();
+    }
+
+  private:
+    template <class T>
+    size_t printFormat(const char* format, T value) {
+      char buffer[24];
+      snprintf(buffer, sizeof(buffer), format, value);
+      return write(buffer);
+    }
+};
+
+#endif
@@ -0,0 +1,65 @@
+/*
+ * hardware/pio.h - Minimal stand-in for the pico-sdk PIO header in the
+ * host tests
+ *
+ * The instruction encoders follow pico-sdk's pio_instructions.h bit for
+ * bit, so tests see the same program words as the target. The state
+ * machine calls are only declared; no test may reach them.
+ *
+ * Created: October 2026
+ */
+
+#ifndef ADF4351_TEST_HARDWARE_PIO_H
+#define ADF4351_TEST_HARDWARE_PIO_H
+
+#include <stdint.h>
+
+typedef unsigned int uint;
+typedef struct pio_hw pio_hw_t;
+typedef pio_hw_t* PIO;
+
+enum pio_src_dest {
+  pio_pins = 0u,
+  pio_x = 1u,
+  pio_y = 2u
+};
+
+// Opcode bits of the instructions the library uses
+enum pio_instr_bits {
+  pio_instr_bits_jmp = 0x0000,
+  pio_instr_bits_out = 0x6000,
+  pio_instr_bits_pull = 0x8080,
+  pio_instr_bits_set = 0xe000
+};
+
+static inline uint _pio_encode_instr_and_args(enum pio_instr_bits instr_bits, uint arg1, uint arg2) {
+  return instr_bits | (arg1 << 5u) | (arg2 & 0x1fu);
+}
+
+static inline uint pio_encode_delay(uint cycles) {
+  return cycles << 8u;
+}
+
+static inline uint pio_encode_sideset(uint sideset_bit_count, uint value) {
+  return value << (13u - sideset_bit_count);
+}
+
+static inline uint pio_encode_jmp_x_dec(uint addr) {
+  return _pio_encode_instr_and_args(pio_instr_bits_jmp, 2, addr);
+}
+
+static inline uint pio_encode_out(enum pio_src_dest dest, uint count) {
+  return _pio_encode_instr_and_args(pio_instr_bits_out, dest & 7u, count);
+}
+
+static inline uint pio_encode_pull(bool if_empty, bool block) {
+  return _pio_encode_instr_and_args(pio_instr_bits_pull, (if_empty ? 2u : 0u) | (block ? 1u : 0u), 0);
+}
+
+static inline uint pio_encode_set(enum pio_src_dest dest, uint value) {
+  return _pio_encode_instr_and_args(pio_instr_bits_set, dest & 7u, value);
+}
+
+void pio_sm_put_blocking(PIO pio, uint sm, uint32_t data);
+
+#endif
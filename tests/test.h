@@ -0,0 +1,68 @@
+/*
+ * test.h - Assertion macros for the host tests
+ *
+ * Each test program calls its TEST() functions from main() and returns
+ * testResult(), so make stops at the first program with a failure:
+ *
+ *   TEST(parsesUnits) {
+ *     CHECK_EQUAL(parse("1MHZ"), 1000000);
+ *   }
+ *
+ *   int main() {
+ *     parsesUnits();
+ *     return testResult();
+ *   }
+ *
+ * Created: October 2026
+ */
+
+#ifndef ADF4351_TEST_H
+#define ADF4351_TEST_H
+
+#include <stdio.h>
+#include <string.h>
+
+static int testChecks = 0;
+static int testFailures = 0;
+
+#define TEST(name) static void name()
+
+// Report a failed check with its location and carry on
+#define CHECK(condition) \
+  do { \
+    testChecks++; \
+    if (!(condition)) { \
+      testFailures++; \
+      printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+    } \
+  } while (0)
+
+#define CHECK_EQUAL(actual, expected) \
+  do { \
+    testChecks++; \
+    long long a_ = (long long)(actual); \
+    long long e_ = (long long)(expected); \
+    if (a_ != e_) { \
+      testFailures++; \
+      printf("%s:%d: %s is %lld, expected %lld\n", __FILE__, __LINE__, #actual, a_, e_); \
+    } \
+  } while (0)
+
+#define CHECK_STRING(actual, expected) \
+  do { \
+    testChecks++; \
+    const char* a_ = (actual); \
+    const char* e_ = (expected); \
+    if (strcmp(a_, e_) != 0) { \
+      testFailures++; \
+      printf("%s:%d: %s is \"%s\", expected \"%s\"\n", __FILE__, __LINE__, #actual, a_, e_); \
+    } \
+  } while (0)
+
+// Print the summary; the exit status is 1 if any check failed
+static int testResult() {
+  printf("%d checks, %d failed\n", testChecks, testFailures);
+  return testFailures == 0 ? 0 : 1;
+}
+
+#endif
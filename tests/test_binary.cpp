@@ -0,0 +1,213 @@
+/*
+ * test_binary.cpp - Host tests for the binary protocol framing
+ * (ADF4351_Binary.h)
+ *
+ * Checks the CRC against the CRC-16/CCITT-FALSE check value, round trips
+ * COBS over zero runs and the 254-byte block boundaries, and feeds
+ * truncated and corrupted frames through the same decode and CRC test
+ * the controller's processFrame() applies.
+ *
+ * Created: October 2026
+ */
+
+#include "test.h"
+#include "ADF4351_Binary.h"
+
+// Largest test input, and its worst case COBS size
+#define MAX_DATA 1024
+#define MAX_ENCODED (MAX_DATA + MAX_DATA / 254 + 1)
+
+// Decode a frame and check its CRC as processFrame() does; returns the
+// payload length without the CRC, or -1 if the frame is rejected
+static int checkFrame(uint8_t* frame, uint16_t length) {
+  uint16_t size = ADF4351Binary::decode(frame, length);
+  if (size < ADF4351_BINARY_HEADER + ADF4351_BINARY_CRC ||
+      ADF4351Binary::crc16(frame, size - ADF4351_BINARY_CRC) != ADF4351Binary::get16(frame + size - ADF4351_BINARY_CRC)) {
+    return -1;
+  }
+  return size - ADF4351_BINARY_CRC;
+}
+
+// Build a request frame (without the delimiter) from a payload
+static uint16_t buildFrame(const uint8_t* payload, uint16_t length, uint8_t* out) {
+  uint8_t data[MAX_DATA];
+  memcpy(data, payload, length);
+  uint16_t crc = ADF4351Binary::crc16(payload, length);
+  data[length] = (uint8_t)crc;
+  data[length + 1] = (uint8_t)(crc >> 8);
+  return ADF4351Binary::encode(data, length + ADF4351_BINARY_CRC, out);
+}
+
+// Encode data, check the result is a valid COBS frame of bounded size,
+// and decode it back
+static void roundTrip(const uint8_t* data, uint16_t length) {
+  uint8_t encoded[MAX_ENCODED];
+  uint16_t encodedLength = ADF4351Binary::encode(data, length, encoded);
+  CHECK(encodedLength <= length + length / 254 + 1);
+  CHECK(memchr(encoded, 0, encodedLength) == NULL);
+
+  CHECK_EQUAL(ADF4351Binary::decode(encoded, encodedLength), length);
+  CHECK(memcmp(encoded, data, length) == 0);
+}
+
+TEST(crcCheckValue) {
+  const char* check = "123456789";
+  CHECK_EQUAL(ADF4351Binary::crc16((const uint8_t*)check, 9), 0x29B1);
+  CHECK_EQUAL(ADF4351Binary::crc16(NULL, 0), 0xFFFF);
+}
+
+TEST(cobsKnownEncodings) {
+  // Examples from the COBS paper
+  const uint8_t zero[] = {0x00};
+  const uint8_t zeros[] = {0x00, 0x00};
+  const uint8_t mixed[] = {0x11, 0x22, 0x00, 0x33};
+  uint8_t out[8];
+
+  CHECK_EQUAL(ADF4351Binary::encode(zero, sizeof(zero), out), 2);
+  CHECK(out[0] == 0x01 && out[1] == 0x01);
+  CHECK_EQUAL(ADF4351Binary::encode(zeros, sizeof(zeros), out), 3);
+  CHECK(out[0] == 0x01 && out[1] == 0x01 && out[2] == 0x01);
+  CHECK_EQUAL(ADF4351Binary::encode(mixed, sizeof(mixed), out), 5);
+  CHECK(out[0] == 0x03 && out[1] == 0x11 && out[2] == 0x22 && out[3] == 0x02 && out[4] == 0x33);
+}
+
+TEST(cobsZeroRuns) {
+  uint8_t data[MAX_DATA];
+
+  // Empty, all zeros, and zero runs between data bytes
+  memset(data, 0, sizeof(data));
+  roundTrip(data, 0);
+  for (uint16_t length = 1; length <= 16; length++) {
+    roundTrip(data, length);
+  }
+  roundTrip(data, 600);
+
+  for (uint16_t i = 0; i < 600; i++) {
+    data[i] = (i / 3) % 4 == 0 ? 0 : (uint8_t)(i + 1);
+  }
+  roundTrip(data, 600);
+
+  // Zero at the start and at the end
+  memset(data, 0x55, 8);
+  data[0] = 0;
+  data[7] = 0;
+  roundTrip(data, 8);
+}
+
+TEST(cobsBlocks) {
+  // Runs of non-zero bytes around the 254-byte block length, alone and
+  // followed by a zero
+  uint8_t data[MAX_DATA];
+  for (uint16_t i = 0; i < sizeof(data); i++) {
+    data[i] = (uint8_t)(i % 255 + 1);
+  }
+  const uint16_t lengths[] = {253, 254, 255, 508, 509, 1000};
+  for (uint8_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+    roundTrip(data, lengths[i]);
+  }
+  for (uint8_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+    uint8_t saved = data[lengths[i]];
+    data[lengths[i]] = 0;
+    roundTrip(data, lengths[i] + 1);
+    data[lengths[i]] = saved;
+  }
+
+  // The minimal encoding of a full block has no trailing code byte
+  uint8_t frame[255];
+  frame[0] = 0xFF;
+  memcpy(frame + 1, data, 254);
+  CHECK_EQUAL(ADF4351Binary::decode(frame, sizeof(frame)), 254);
+  CHECK(memcmp(frame, data, 254) == 0);
+}
+
+TEST(validFrames) {
+  // SET_FREQUENCY 145 MHz: the argument holds no zero byte, the CRC may
+  const uint8_t request[] = {0x07, ADF4351_OP_SET_FREQUENCY, 0x40, 0x86, 0xA4, 0x08};
+  uint8_t frame[MAX_ENCODED];
+  uint16_t length = buildFrame(request, sizeof(request), frame);
+  CHECK_EQUAL(checkFrame(frame, length), sizeof(request));
+  CHECK_EQUAL(frame[0], 0x07);
+  CHECK_EQUAL(ADF4351Binary::get32(frame + ADF4351_BINARY_HEADER), 145000000);
+
+  // Largest BATCH request
+  uint8_t batch[ADF4351_BINARY_MAX_PAYLOAD];
+  batch[0] = 0x08;
+  batch[1] = ADF4351_OP_BATCH;
+  batch[2] = 100;
+  batch[3] = 0;
+  for (uint8_t i = 0; i < ADF4351_BINARY_MAX_BATCH; i++) {
+    ADF4351Binary::put32(batch + 4 + 4 * i, 144000000 + 12500 * i);
+  }
+  length = buildFrame(batch, sizeof(batch), frame);
+  CHECK(length <= ADF4351_BINARY_MAX_FRAME);
+  CHECK_EQUAL(checkFrame(frame, length), sizeof(batch));
+  CHECK(memcmp(frame, batch, sizeof(batch)) == 0);
+}
+
+TEST(responseFrames) {
+  uint8_t out[ADF4351_BINARY_RESPONSE + 4];
+  uint8_t length = ADF4351Binary::response(out, 0x21, ADF4351_OP_QUERY, ADF4351_STATUS_OK,
+                                           ADF4351_BINARY_FLAG_LOCKED, 435000000, -250);
+  CHECK(length <= sizeof(out));
+  CHECK_EQUAL(out[length - 1], 0);
+  CHECK(memchr(out, 0, length - 1) == NULL);
+
+  CHECK_EQUAL(checkFrame(out, length - 1), ADF4351_BINARY_RESPONSE);
+  CHECK_EQUAL(out[0], 0x21);
+  CHECK_EQUAL(out[1], ADF4351_OP_QUERY);
+  CHECK_EQUAL(out[2], ADF4351_STATUS_OK);
+  CHECK_EQUAL(out[3], ADF4351_BINARY_FLAG_LOCKED);
+  CHECK_EQUAL(ADF4351Binary::get32(out + 4), 435000000);
+  CHECK_EQUAL((int32_t)ADF4351Binary::get32(out + 8), -250);
+}
+
+TEST(truncatedFrames) {
+  const uint8_t request[] = {0x09, ADF4351_OP_RETUNE, 0x00, 0x00, 0x00, 0x00, 0x11, 0x22};
+  uint8_t frame[MAX_ENCODED];
+  uint16_t length = buildFrame(request, sizeof(request), frame);
+
+  // Every shorter prefix fails COBS, the length check or the CRC
+  for (uint16_t cut = 0; cut < length; cut++) {
+    uint8_t copy[MAX_ENCODED];
+    memcpy(copy, frame, length);
+    CHECK_EQUAL(checkFrame(copy, cut), -1);
+  }
+
+  // A code byte pointing past the end
+  uint8_t overrun[] = {0x05, 0x11, 0x22};
+  CHECK_EQUAL(ADF4351Binary::decode(overrun, sizeof(overrun)), 0);
+}
+
+TEST(corruptedFrames) {
+  const uint8_t request[] = {0x0A, ADF4351_OP_SET_POWER, 0x03};
+  uint8_t frame[MAX_ENCODED];
+  uint16_t length = buildFrame(request, sizeof(request), frame);
+
+  // Any single bit error in the frame is caught
+  for (uint16_t i = 0; i < length; i++) {
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      uint8_t copy[MAX_ENCODED];
+      memcpy(copy, frame, length);
+      copy[i] ^= 1 << bit;
+      CHECK_EQUAL(checkFrame(copy, length), -1);
+    }
+  }
+
+  // A 0x00 inside a frame is not valid COBS
+  uint8_t copy[MAX_ENCODED];
+  memcpy(copy, frame, length);
+  copy[0] = 0;
+  CHECK_EQUAL(ADF4351Binary::decode(copy, length), 0);
+}
+
+int main() {
+  crcCheckValue();
+  cobsKnownEncodings();
+  cobsZeroRuns();
+  cobsBlocks();
+  validFrames();
+  responseFrames();
+  truncatedFrames();
+  corruptedFrames();
+  return testResult();
+}
@@ -0,0 +1,246 @@
+/*
+ * test_pio.cpp - Host tests for the PIO serial program (ADF4351_PIO.h)
+ *
+ * Runs the assembled program through a cycle by cycle model of a PIO
+ * state machine, at the divider clockDivider() picks for a range of
+ * system and serial clocks, and measures the ADF4351 serial timing from
+ * the resulting CLK, DATA and LE edges:
+ *
+ *   t1 LE setup to first CLK    >= 10 ns   (LE falling to CLK rising)
+ *   t2 DATA setup to CLK        >= 10 ns   (DATA written to CLK rising)
+ *   t3 DATA hold after CLK      >= 10 ns   (CLK rising to next DATA write)
+ *   t4 CLK high                 >= 25 ns
+ *   t5 CLK low                  >= 25 ns
+ *   t6 last CLK to LE high      >= 10 ns   (CLK rising to LE rising)
+ *   t7 LE high between words    >= 20 ns
+ *
+ * The model executes only what the program uses: PULL block, SET to
+ * pins and X, OUT to pins (shifting left, MSB first), JMP X-- and one
+ * side-set bit, with delays and wrap. Side-set takes effect when an
+ * instruction issues, also while PULL stalls.
+ *
+ * Created: October 2026
+ */
+
+#include "test.h"
+#include "ADF4351_PIO.h"
+
+// ADF4351 datasheet minimums (ns)
+static const double T_MIN[8] = {0, 10, 10, 10, 25, 25, 10, 20};
+
+// Words of a full register update, then bit patterns
+static const uint32_t WORDS[] = {
+  0x00580005, 0x00800024, 0x000004B3, 0x00004E42, 0x08008011, 0x00580000,
+  0xAAAAAAAA, 0x55555555, 0xFFFFFFFF, 0x00000000
+};
+static const uint8_t WORD_COUNT = sizeof(WORDS) / sizeof(WORDS[0]);
+
+enum Pin { PIN_LE, PIN_CLK, PIN_DATA, PIN_COUNT };
+
+// One pin write, at a state machine cycle
+struct PinEvent {
+  uint32_t cycle;
+  uint8_t pin;
+  bool level;
+};
+
+// Result of one run: t1-t7 minimums (ns) and the words the ADF4351 saw
+struct PioRun {
+  double t[8];
+  uint32_t received[WORD_COUNT];
+  uint8_t receivedCount;
+  uint32_t clockCycles;  // State machine cycles per CLK period
+  bool ok;               // The program only used modelled instructions
+};
+
+// Execute the program until it stalls on an empty FIFO; returns the
+// number of events recorded
+static uint16_t execute(const uint16_t* program, PinEvent* events, uint16_t maxEvents, bool& ok) {
+  uint16_t count = 0;
+  uint8_t fifo = 0;
+  uint32_t osr = 0;
+  uint32_t x = 0;
+  uint8_t pc = 0;
+  uint32_t cycle = 0;
+  ok = true;
+
+  while (count + 2 <= maxEvents) {
+    uint16_t instruction = program[pc];
+    uint8_t opcode = instruction >> 13;
+    uint8_t delay = (instruction >> 8) & 0x0F;
+    uint8_t arg1 = (instruction >> 5) & 0x07;
+    uint8_t arg2 = instruction & 0x1F;
+    uint8_t next = pc == ADF4351_PIO_PROGRAM_LENGTH - 1 ? 0 : pc + 1;
+
+    // Side-set drives CLK as the instruction issues
+    events[count++] = {cycle, PIN_CLK, ((instruction >> 12) & 0x01) != 0};
+
+    if (opcode == 4 && (instruction & 0x80) && (instruction & 0x20)) {
+      // PULL block: stall (and stop the run) on an empty FIFO
+      if (fifo == WORD_COUNT) {
+        break;
+      }
+      osr = WORDS[fifo++];
+    } else if (opcode == 7 && arg1 == 0) {
+      events[count++] = {cycle, PIN_LE, (arg2 & 0x01) != 0};
+    } else if (opcode == 7 && arg1 == 1) {
+      x = arg2;
+    } else if (opcode == 3 && arg1 == 0 && arg2 == 1) {
+      events[count++] = {cycle, PIN_DATA, (osr >> 31) != 0};
+      osr <<= 1;
+    } else if (opcode == 0 && arg1 == 2) {
+      if (x != 0) {
+        next = arg2;
+      }
+      x--;
+    } else {
+      ok = false;
+      break;
+    }
+
+    pc = next;
+    cycle += 1 + delay;
+  }
+  return count;
+}
+
+// Run every word through the program at the given clocks and measure
+static PioRun run(uint32_t sysHz, uint32_t div) {
+  PioRun result;
+  memset(&result, 0, sizeof(result));
+  for (uint8_t i = 1; i < 8; i++) {
+    result.t[i] = 1e9;
+  }
+
+  uint16_t program[ADF4351_PIO_PROGRAM_LENGTH];
+  ADF4351Pio::assemble(program);
+  static PinEvent events[4096];
+  uint16_t count = execute(program, events, 4096, result.ok);
+  if (!result.ok) {
+    return result;
+  }
+
+  // Walk the events, starting from the idle levels
+  double ns = 1e9 * div / sysHz;
+  bool level[PIN_COUNT] = {true, false, false};
+  double leFall = -1, leRise = -1;
+  double clkRise = -1, clkFall = -1, lastRise = -1;
+  double dataWrite = -1;
+  uint8_t bits = 0;
+  uint32_t word = 0;
+  uint32_t firstRise = 0, secondRise = 0;
+
+  for (uint16_t i = 0; i < count; i++) {
+    const PinEvent& event = events[i];
+    double time = event.cycle * ns;
+    bool changed = level[event.pin] != event.level;
+    level[event.pin] = event.level;
+
+    if (event.pin == PIN_DATA) {
+      // Hold from the last rising CLK edge to the next DATA write
+      if (clkRise >= 0 && bits > 0) {
+        if (time - clkRise < result.t[3]) result.t[3] = time - clkRise;
+      }
+      dataWrite = time;
+    } else if (event.pin == PIN_CLK && changed && event.level) {
+      if (bits == 0) {
+        if (time - leFall < result.t[1]) result.t[1] = time - leFall;
+        firstRise = event.cycle;
+      } else if (bits == 1) {
+        secondRise = event.cycle;
+      }
+      if (time - dataWrite < result.t[2]) result.t[2] = time - dataWrite;
+      if (clkFall >= 0 && bits > 0) {
+        if (time - clkFall < result.t[5]) result.t[5] = time - clkFall;
+      }
+      word = (word << 1) | (level[PIN_DATA] ? 1 : 0);
+      bits++;
+      clkRise = time;
+      lastRise = time;
+    } else if (event.pin == PIN_CLK && changed) {
+      if (time - clkRise < result.t[4]) result.t[4] = time - clkRise;
+      clkFall = time;
+    } else if (event.pin == PIN_LE && changed && !event.level) {
+      if (leRise >= 0) {
+        if (time - leRise < result.t[7]) result.t[7] = time - leRise;
+      }
+      leFall = time;
+      bits = 0;
+      word = 0;
+      clkRise = -1;
+      clkFall = -1;
+    } else if (event.pin == PIN_LE && changed) {
+      if (time - lastRise < result.t[6]) result.t[6] = time - lastRise;
+      if (bits == 32 && result.receivedCount < WORD_COUNT) {
+        result.received[result.receivedCount++] = word;
+      }
+      leRise = time;
+    }
+  }
+  result.clockCycles = secondRise - firstRise;
+  return result;
+}
+
+// Check one system clock / requested serial clock pair
+static void checkTiming(uint32_t sysHz, uint32_t clockHz) {
+  uint32_t div = ADF4351Pio::clockDivider(sysHz, clockHz);
+  PioRun result = run(sysHz, div);
+  CHECK(result.ok);
+
+  // Never faster than requested
+  CHECK(sysHz / (4 * div) <= clockHz);
+  CHECK_EQUAL(result.clockCycles, 4);
+
+  // Every word arrives whole, MSB first
+  CHECK_EQUAL(result.receivedCount, WORD_COUNT);
+  for (uint8_t i = 0; i < result.receivedCount; i++) {
+    CHECK_EQUAL(result.received[i], WORDS[i]);
+  }
+
+  for (uint8_t i = 1; i < 8; i++) {
+    if (result.t[i] < T_MIN[i]) {
+      CHECK(result.t[i] >= T_MIN[i]);
+      printf("  t%u = %.2f ns at %lu Hz system clock, %lu Hz requested, divider %lu\n",
+             i, result.t[i], (unsigned long)sysHz, (unsigned long)clockHz, (unsigned long)div);
+    }
+  }
+}
+
+TEST(timingAtChosenDividers) {
+  const uint32_t systemClocks[] = {48000000, 125000000, 133000000, 150000000, 200000000, 250000000};
+  const uint32_t serialClocks[] = {ADF4351_PIO_CLOCK, 20000000, 16000000, 10000000, 1000000, 100000};
+  for (uint8_t s = 0; s < sizeof(systemClocks) / sizeof(systemClocks[0]); s++) {
+    for (uint8_t c = 0; c < sizeof(serialClocks) / sizeof(serialClocks[0]); c++) {
+      checkTiming(systemClocks[s], serialClocks[c]);
+    }
+  }
+}
+
+TEST(cycleCounts) {
+  // At 1 ns per cycle the measurements are the cycle counts in the
+  // ADF4351_PIO.cpp table
+  PioRun result = run(1000000000, 1);
+  CHECK(result.ok);
+  CHECK_EQUAL(result.t[1], 4);
+  CHECK_EQUAL(result.t[2], 2);
+  CHECK_EQUAL(result.t[3], 2);
+  CHECK_EQUAL(result.t[4], 2);
+  CHECK_EQUAL(result.t[5], 2);
+  CHECK_EQUAL(result.t[6], 2);
+  CHECK_EQUAL(result.t[7], 3);
+}
+
+TEST(tooFastIsCaught) {
+  // Undivided at 150 MHz the CLK high time is 13.3 ns, under t4
+  PioRun result = run(150000000, 1);
+  CHECK(result.ok);
+  CHECK(result.t[4] < T_MIN[4]);
+  CHECK(result.t[5] < T_MIN[5]);
+}
+
+int main() {
+  timingAtChosenDividers();
+  cycleCounts();
+  tooFastIsCaught();
+  return testResult();
+}
@@ -0,0 +1,346 @@
+/*
+ * test_scpi.cpp - Host tests for the SCPI front end (ADF4351_Scpi.h)
+ *
+ * Runs a small command set modelled on the controller's through
+ * ADF4351Scpi::execute() and checks what reaches the handlers, what is
+ * printed and what is queued as an error.
+ *
+ * Created: October 2026
+ */
+
+#include "test.h"
+#include "ADF4351_Scpi.h"
+
+// Print collecting everything written into a string
+class CaptureOutput : public Print {
+  public:
+    CaptureOutput() { clear(); }
+
+    size_t write(uint8_t c) override {
+      if (_length < sizeof(_text) - 1) {
+        _text[_length++] = c;
+        _text[_length] = '\0';
+      }
+      return 1;
+    }
+
+    using Print::write;
+
+    void clear() {
+      _length = 0;
+      _text[0] = '\0';
+    }
+
+    const char* text() { return _text; }
+
+  private:
+    char _text[256];
+    size_t _length;
+};
+
+// Settings written by the handlers
+static uint32_t frequency;
+static uint32_t power;
+static uint32_t sweepStart;
+static uint32_t sweepStop;
+static uint32_t sweepDwell;
+static bool outputOn;
+static int handlerCalls;
+
+static int16_t setFrequency(const char* parameter, Print& response) {
+  handlerCalls++;
+  return ADF4351Scpi::parseFrequency(parameter, frequency);
+}
+
+static int16_t queryFrequency(const char* parameter, Print& response) {
+  response.print((unsigned long)frequency);
+  return ADF4351_SCPI_NO_ERROR;
+}
+
+static int16_t setPower(const char* parameter, Print& response) {
+  uint32_t level;
+  int16_t error = ADF4351Scpi::parseUint(parameter, level);
+  if (error != ADF4351_SCPI_NO_ERROR) {
+    return error;
+  }
+  if (level > 3) {
+    return ADF4351_SCPI_OUT_OF_RANGE;
+  }
+  power = level;
+  return ADF4351_SCPI_NO_ERROR;
+}
+
+static int16_t queryPower(const char* parameter, Print& response) {
+  response.print((unsigned long)power);
+  return ADF4351_SCPI_NO_ERROR;
+}
+
+static int16_t setOutput(const char* parameter, Print& response) {
+  return ADF4351Scpi::parseBool(parameter, outputOn);
+}
+
+static int16_t setSweepStart(const char* parameter, Print& response) {
+  return ADF4351Scpi::parseFrequency(parameter, sweepStart);
+}
+
+static int16_t setSweepStop(const char* parameter, Print& response) {
+  return ADF4351Scpi::parseFrequency(parameter, sweepStop);
+}
+
+static int16_t setSweepDwell(const char* parameter, Print& response) {
+  return ADF4351Scpi::parseTime(parameter, sweepDwell);
+}
+
+static int16_t identify(const char* parameter, Print& response) {
+  response.print("ADF4351,Test,0,1.0");
+  return ADF4351_SCPI_NO_ERROR;
+}
+
+static int16_t operationComplete(const char* parameter, Print& response) {
+  response.print('1');
+  return ADF4351_SCPI_NO_ERROR;
+}
+
+static const ADF4351ScpiCommand COMMANDS[] = {
+  {"*IDN?", identify},
+  {"*OPC?", operationComplete},
+  {"[SOURce]:FREQuency[:CW]", setFrequency},
+  {"[SOURce]:FREQuency[:CW]?", queryFrequency},
+  {"[SOURce]:POWer[:LEVel]", setPower},
+  {"[SOURce]:POWer[:LEVel]?", queryPower},
+  {"OUTPut[:STATe]", setOutput},
+  {"SWEep:STARt", setSweepStart},
+  {"SWEep:STOP", setSweepStop},
+  {"SWEep:DWELl", setSweepDwell}
+};
+
+static CaptureOutput output;
+static ADF4351Scpi scpi(COMMANDS, output);
+
+// Run one line and return what it printed
+static const char* run(const char* text) {
+  char line[128];
+  strncpy(line, text, sizeof(line) - 1);
+  line[sizeof(line) - 1] = '\0';
+  output.clear();
+  scpi.execute(line);
+  return output.text();
+}
+
+// Run a line that should fail and return its one queued error
+static int16_t runError(const char* text) {
+  scpi.clearErrors();
+  run(text);
+  int16_t code = scpi.popError();
+  CHECK_EQUAL(scpi.popError(), ADF4351_SCPI_NO_ERROR);
+  return code;
+}
+
+// Parse a frequency and return the value, or the error code
+static long long frequencyOf(const char* text) {
+  uint32_t hz = 0;
+  int16_t error = ADF4351Scpi::parseFrequency(text, hz);
+  return error != ADF4351_SCPI_NO_ERROR ? error : (long long)hz;
+}
+
+static long long timeOf(const char* text) {
+  uint32_t us = 0;
+  int16_t error = ADF4351Scpi::parseTime(text, us);
+  return error != ADF4351_SCPI_NO_ERROR ? error : (long long)us;
+}
+
+TEST(shortAndLongMnemonics) {
+  const char* lines[] = {
+    "FREQ 1", "FREQuency 2", "frequency 3", "FrEq 4", "SOUR:FREQ 5", "SOURce:FREQuency:CW 6",
+    "sour:freq:cw 7", "FREQ:CW 8", ":SOUR:FREQ 9"
+  };
+  for (uint8_t i = 0; i < sizeof(lines) / sizeof(lines[0]); i++) {
+    scpi.clearErrors();
+    run(lines[i]);
+    CHECK_EQUAL(frequency, i + 1);
+    CHECK_EQUAL(scpi.popError(), ADF4351_SCPI_NO_ERROR);
+  }
+
+  // Neither the short nor the long form, or a node too many
+  CHECK_EQUAL(runError("FREQU 1"), ADF4351_SCPI_UNDEFINED_HEADER);
+  CHECK_EQUAL(runError("FRE 1"), ADF4351_SCPI_UNDEFINED_HEADER);
+  CHECK_EQUAL(runError("FREQ:CWX 1"), ADF4351_SCPI_UNDEFINED_HEADER);
+  CHECK_EQUAL(runError("SOUR:FREQ:CW:CW 1"), ADF4351_SCPI_UNDEFINED_HEADER);
+  CHECK_EQUAL(runError("FREQ: 1"), ADF4351_SCPI_UNDEFINED_HEADER);
+
+  // Required nodes can't be left out
+  CHECK_EQUAL(runError("STAR 1"), ADF4351_SCPI_UNDEFINED_HEADER);
+
+  // Optional nodes at the end
+  run("OUTP ON");
+  CHECK(outputOn);
+  run("OUTPut:STATe OFF");
+  CHECK(!outputOn);
+  run("POW:LEV 2");
+  CHECK_EQUAL(power, 2);
+}
+
+TEST(compoundLines) {
+  scpi.clearErrors();
+
+  // Relative headers continue from the previous command's path
+  run("SWE:STAR 100MHZ;STOP 200MHZ;DWEL 50US");
+  CHECK_EQUAL(sweepStart, 100000000);
+  CHECK_EQUAL(sweepStop, 200000000);
+  CHECK_EQUAL(sweepDwell, 50);
+
+  // Common commands leave the path alone
+  run("SWE:STAR 1MHZ;*OPC?;STOP 3MHZ");
+  CHECK_EQUAL(sweepStart, 1000000);
+  CHECK_EQUAL(sweepStop, 3000000);
+
+  // A leading ':' starts again from the root
+  run(":SWE:STAR 1GHZ;:FREQ 2GHZ");
+  CHECK_EQUAL(sweepStart, 1000000000);
+  CHECK_EQUAL(frequency, 2000000000);
+
+  // Empty commands and white space are skipped
+  run(" ; ;FREQ 1 ;");
+  CHECK_EQUAL(frequency, 1);
+  CHECK_EQUAL(scpi.popError(), ADF4351_SCPI_NO_ERROR);
+
+  // An error stops only its own command
+  handlerCalls = 0;
+  run("FREQ 5;BOGUS;FREQ 6");
+  CHECK_EQUAL(handlerCalls, 2);
+  CHECK_EQUAL(frequency, 6);
+  CHECK_EQUAL(scpi.popError(), ADF4351_SCPI_UNDEFINED_HEADER);
+  CHECK_EQUAL(scpi.popError(), ADF4351_SCPI_NO_ERROR);
+
+  // All answers of a line come back on one line
+  frequency = 145000000;
+  power = 3;
+  CHECK_STRING(run("FREQ?;POW?;*IDN?"), "145000000;3;ADF4351,Test,0,1.0\r\n");
+  CHECK_STRING(run("*idn?;*OPC?"), "ADF4351,Test,0,1.0;1\r\n");
+}
+
+TEST(unitsAndExponents) {
+  CHECK_EQUAL(frequencyOf("145000000"), 145000000);
+  CHECK_EQUAL(frequencyOf("145MHZ"), 145000000);
+  CHECK_EQUAL(frequencyOf("145.5 MHz"), 145500000);
+  CHECK_EQUAL(frequencyOf("100 kHz"), 100000);
+  CHECK_EQUAL(frequencyOf("2.5GHZ"), 2500000000UL);
+  CHECK_EQUAL(frequencyOf("10 hz"), 10);
+  CHECK_EQUAL(frequencyOf("+35MHZ"), 35000000);
+  CHECK_EQUAL(frequencyOf("1.2E9"), 1200000000);
+  CHECK_EQUAL(frequencyOf("1.2e+9"), 1200000000);
+  CHECK_EQUAL(frequencyOf("145E6HZ"), 145000000);
+  CHECK_EQUAL(frequencyOf("1.2345678e3khz"), 1234568);
+  CHECK_EQUAL(frequencyOf("4.2E3MHZ"), 4200000000UL);
+  CHECK_EQUAL(frequencyOf("0.4999"), 0);
+  CHECK_EQUAL(frequencyOf("0.5"), 1);
+  CHECK_EQUAL(frequencyOf("1E-30"), 0);
+  CHECK_EQUAL(frequencyOf("0E99"), 0);
+  CHECK_EQUAL(frequencyOf("0.000000000000000000001GHZ"), 0);
+
+  CHECK_EQUAL(frequencyOf(""), ADF4351_SCPI_MISSING_PARAMETER);
+  CHECK_EQUAL(frequencyOf("MHZ"), ADF4351_SCPI_DATA_TYPE_ERROR);
+  CHECK_EQUAL(frequencyOf("."), ADF4351_SCPI_DATA_TYPE_ERROR);
+  CHECK_EQUAL(frequencyOf("1E"), ADF4351_SCPI_SYNTAX_ERROR);
+  CHECK_EQUAL(frequencyOf("1E+"), ADF4351_SCPI_SYNTAX_ERROR);
+  CHECK_EQUAL(frequencyOf("145 MEGA"), ADF4351_SCPI_INVALID_SUFFIX);
+  CHECK_EQUAL(frequencyOf("145 MHZZ"), ADF4351_SCPI_INVALID_SUFFIX);
+  CHECK_EQUAL(frequencyOf("1.2.3"), ADF4351_SCPI_INVALID_SUFFIX);
+  CHECK_EQUAL(frequencyOf("-5"), ADF4351_SCPI_OUT_OF_RANGE);
+  CHECK_EQUAL(frequencyOf("5GHZ"), ADF4351_SCPI_OUT_OF_RANGE);
+  CHECK_EQUAL(frequencyOf("4294967296"), ADF4351_SCPI_OUT_OF_RANGE);
+  CHECK_EQUAL(frequencyOf("99999999999999999999999"), ADF4351_SCPI_OUT_OF_RANGE);
+  CHECK_EQUAL(frequencyOf("1E99"), ADF4351_SCPI_OUT_OF_RANGE);
+  CHECK_EQUAL(frequencyOf("4294967295"), 4294967295UL);
+
+  // Times default to seconds
+  CHECK_EQUAL(timeOf("0.001"), 1000);
+  CHECK_EQUAL(timeOf("2"), 2000000);
+  CHECK_EQUAL(timeOf("5E-5"), 50);
+  CHECK_EQUAL(timeOf("1MS"), 1000);
+  CHECK_EQUAL(timeOf("50 us"), 50);
+  CHECK_EQUAL(timeOf("1.5 s"), 1500000);
+  CHECK_EQUAL(timeOf("1500NS"), 2);
+  CHECK_EQUAL(timeOf("1HZ"), ADF4351_SCPI_INVALID_SUFFIX);
+
+  uint32_t value;
+  CHECK_EQUAL(ADF4351Scpi::parseUint("42", value), ADF4351_SCPI_NO_ERROR);
+  CHECK_EQUAL(value, 42);
+  CHECK_EQUAL(ADF4351Scpi::parseUint("4 MHZ", value), ADF4351_SCPI_INVALID_SUFFIX);
+
+  bool state;
+  CHECK_EQUAL(ADF4351Scpi::parseBool("on", state), ADF4351_SCPI_NO_ERROR);
+  CHECK(state);
+  CHECK_EQUAL(ADF4351Scpi::parseBool("0", state), ADF4351_SCPI_NO_ERROR);
+  CHECK(!state);
+  CHECK_EQUAL(ADF4351Scpi::parseBool("2", state), ADF4351_SCPI_ILLEGAL_VALUE);
+  CHECK_EQUAL(ADF4351Scpi::parseBool("", state), ADF4351_SCPI_MISSING_PARAMETER);
+
+  // Through a command line, the unit follows after white space
+  scpi.clearErrors();
+  run("FREQ 145.5 MHz");
+  CHECK_EQUAL(frequency, 145500000);
+  CHECK_EQUAL(runError("FREQ 145 MEGA"), ADF4351_SCPI_INVALID_SUFFIX);
+  CHECK_EQUAL(runError("POW 4"), ADF4351_SCPI_OUT_OF_RANGE);
+}
+
+TEST(queries) {
+  scpi.clearErrors();
+  frequency = 145000000;
+  CHECK_STRING(run("FREQ?"), "145000000\r\n");
+  CHECK_STRING(run("sour:freq:cw?"), "145000000\r\n");
+  CHECK_STRING(run("SOURce:FREQuency?"), "145000000\r\n");
+
+  // Setters don't answer
+  CHECK_STRING(run("FREQ 100MHZ"), "");
+  CHECK_EQUAL(frequency, 100000000);
+
+  // A query takes no parameter and needs a query header
+  CHECK_EQUAL(runError("FREQ? 5"), ADF4351_SCPI_PARAMETER_NOT_ALLOWED);
+  CHECK_EQUAL(runError("SWE:STAR?"), ADF4351_SCPI_UNDEFINED_HEADER);
+  CHECK_EQUAL(runError("*IDN"), ADF4351_SCPI_UNDEFINED_HEADER);
+
+  // A failed query adds nothing to the answer
+  scpi.clearErrors();
+  CHECK_STRING(run("*OPC?;FREQ? 5;*OPC?"), "1;1\r\n");
+}
+
+TEST(errorQueue) {
+  scpi.clearErrors();
+  CHECK_STRING(run("SYST:ERR?"), "0,\"No error\"\r\n");
+
+  // Oldest first, in the long form too
+  run("BOGUS;FREQ -1");
+  CHECK_STRING(run("SYST:ERR?"), "-113,\"Undefined header\"\r\n");
+  CHECK_STRING(run("SYSTem:ERRor:NEXT?"), "-222,\"Data out of range\"\r\n");
+  CHECK_STRING(run("syst:err?"), "0,\"No error\"\r\n");
+
+  // The last entry of a full queue turns into a queue overflow
+  for (uint8_t i = 0; i < ADF4351_SCPI_ERROR_QUEUE + 3; i++) {
+    run("BOGUS");
+  }
+  for (uint8_t i = 0; i < ADF4351_SCPI_ERROR_QUEUE - 1; i++) {
+    CHECK_EQUAL(scpi.popError(), ADF4351_SCPI_UNDEFINED_HEADER);
+  }
+  CHECK_EQUAL(scpi.popError(), ADF4351_SCPI_QUEUE_OVERFLOW);
+  CHECK_EQUAL(scpi.popError(), ADF4351_SCPI_NO_ERROR);
+
+  // Room again once read
+  run("BOGUS");
+  CHECK_EQUAL(scpi.popError(), ADF4351_SCPI_UNDEFINED_HEADER);
+
+  // *CLS empties the queue
+  run("BOGUS;BOGUS");
+  CHECK_STRING(run("*CLS;SYST:ERR?"), "0,\"No error\"\r\n");
+
+  CHECK_STRING(ADF4351Scpi::errorMessage(ADF4351_SCPI_QUEUE_OVERFLOW), "Queue overflow");
+}
+
+int main() {
+  shortAndLongMnemonics();
+  compoundLines();
+  unitsAndExponents();
+  queries();
+  errorQueue();
+  return testResult();
+}